@@ -1,1022 +1,7851 @@
 #include <iostream>
 #include <string>
 #include <bits/stdc++.h>
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
 using namespace std;
 
 // Global variables
-const int maxBorrows = 10;  // Maximum books a student can borrow at once
-const int maxReserve = 5;   // Maximum books a student can reserve
-const int loanDuration = 3; // Loan duration in days
+const int maxBorrows = 10;  // Loan slots per student; no patron class may allow more
+const int maxReserve = 5;   // Maximum books an undergraduate can reserve
+const int loanDuration = 3; // Undergraduate loan duration in days
 
-struct Reserve
+// =====================================================
+// Patron Class Policies
+// =====================================================
+
+enum PatronClass : int
 {
-    int bookID;       // ID of the reserved book
-    string studentID; // ID of the student who made the reservation
+    Undergraduate,
+    Staff,
+    Faculty,
+    BuiltInPatronClasses // Custom classes registered at runtime are numbered from here
 };
 
-struct Loan
+// Built-in classes: every limit is a compile-time constant, so code instantiated for a
+// policy type checks limits against immediates
+template <PatronClass C>
+struct LoanPolicy;
+
+template <>
+struct LoanPolicy<Undergraduate>
 {
-    int bookID;        // ID of the borrowed book
-    string studentID;  // ID of the borrowing student
-    string returnDate; // Date when the book was returned (used for fine calculation)
+    static constexpr int maxBorrows = ::maxBorrows;     // Books on loan at once
+    static constexpr int maxReserve = ::maxReserve;     // Holds at once
+    static constexpr int loanDuration = ::loanDuration; // Days per loan or renewal
+    static constexpr int finePerDay = 2;                // Fine per overdue day after the grace period
+    static constexpr int graceDays = 1;                 // Overdue days that cost nothing
+    static constexpr int fineCap = 20;                  // Most one overdue loan can cost
 };
 
-struct Book
+template <>
+struct LoanPolicy<Staff>
 {
-    string title;        // Book title
-    string author;       // Book author
-    string category;     // Book category or genre
-    string description;  // Short description of the book
-    int id;              // Unique book ID
-    int totalCopies;     // Total copies owned by the library
-    int availableCopies; // Copies currently available for borrowing
+    static constexpr int maxBorrows = 8;
+    static constexpr int maxReserve = 5;
+    static constexpr int loanDuration = 14;
+    static constexpr int finePerDay = 1;
+    static constexpr int graceDays = 2;
+    static constexpr int fineCap = 10;
 };
 
-struct Student
+template <>
+struct LoanPolicy<Faculty>
 {
-    string name;                    // Student name
-    string id;                      // Unique student ID
-    string phoneNumber;             // Student phone number
-    string email;                   // Student email
-    Loan borrowedBooks[maxBorrows]; // Fixed-size array of borrowed books
-    int fine = 0;                   // Total fine owed by the student
+    static constexpr int maxBorrows = 10;
+    static constexpr int maxReserve = 8;
+    static constexpr int loanDuration = 30;
+    static constexpr int finePerDay = 0;
+    static constexpr int graceDays = 0;
+    static constexpr int fineCap = 0;
 };
 
-class LibraryManagementSystem
+// Custom classes: same member names, read at runtime
+struct RuntimeLoanPolicy
 {
-private:
-    vector<Book> books;            // Container holding all books in the library
-    vector<Reserve> reservedBooks; // Container holding all active reservations
-    vector<Student> students;      // Students
+    int maxBorrows;   // Books on loan at once (at most ::maxBorrows)
+    int maxReserve;   // Holds at once
+    int loanDuration; // Days per loan or renewal
+    int finePerDay;   // Fine per overdue day after the grace period
+    int graceDays;    // Overdue days that cost nothing
+    int fineCap;      // Most one overdue loan can cost
+};
 
-public:
-    // =====================================================
-    // Searching & Filtering Operations
-    // =====================================================
+// Checkpointing
+const int checkpointEveryMutations = 50; // Schedule a checkpoint after this many changes
+const int checkpointEverySeconds = 60;   // ...or once this many seconds passed since the last one
 
-    Book *searchBookById(int bookID)
+// Autocomplete
+const int autocompleteTopK = 10; // Completions kept ready at every prefix
+
+// Fuzzy search
+const int fuzzyTopK = 10;        // Closest matches a fuzzy search returns
+const int fuzzyWindowStep = 64;  // Long fields are indexed in windows this many characters apart
+const int fuzzyBlockKeys = 4096; // Postings keys counted per block before its candidates are checked
+
+// Full-text search
+const double bm25K1 = 1.2;       // BM25 term-frequency saturation
+const double bm25B = 0.75;       // BM25 document-length normalization
+const int postingBlockSize = 64; // Postings per skippable block
+
+// Circulation history
+const int eventChunkRows = 65536; // Events per sealed, compressed chunk
+const int eventSealSeconds = 60;  // Oldest an unsealed event gets before it is written out
+
+// Query cache
+const int queryCacheCapacity = 1024; // Search results kept, least recently used evicted first
+
+// Workload recording
+const size_t traceBufferBytes = 65536; // Encoded calls held in memory before they are written out
+const char traceVersion = 4;           // Bumped whenever the header or an operation's argument layout changes
+
+// Parallel reports
+const int reportChunkRows = 4096; // Records per work-stealing chunk
+
+// Request server
+const int serverMaxRequestBytes = 65536; // Longest request line; a longer one closes the connection
+
+// Persistence
+const string dataFileHeader = "LibraryData 2"; // First line of the current data file format
+
+// Compact storage (builds with -DLMS_COMPACT_TEXT)
+const int frontCodingRun = 16;          // Texts per front-coded run in compact pools
+const size_t textPageMinBytes = 256;    // First page of a pool; later ones double in size
+const size_t textPageBytes = 64 * 1024; // Largest page; a longer text gets a page of its own
+
+// Transactions
+const int transactionAttempts = 3; // Commits tried before a workflow that keeps conflicting gives up
+
+// =====================================================
+// Memory Accounting (heap bytes owned by containers)
+// =====================================================
+
+// Estimates of what a container holds on the heap beyond its own sizeof; element heap
+// (strings inside a vector, say) is added by the caller, which knows the element type.
+inline size_t heapBytes(const string &text)
+{
+    return text.capacity() > 15 ? text.capacity() + 1 : 0; // shorter texts live in the object
+}
+
+template <typename T>
+size_t heapBytes(const vector<T> &items)
+{
+    return items.capacity() * sizeof(T);
+}
+
+inline size_t heapBytes(const vector<bool> &items)
+{
+    return items.capacity() / 8; // one bit per element
+}
+
+template <typename K, typename V>
+size_t heapBytes(const unordered_map<K, V> &items)
+{
+    // Bucket array plus one node per element: the pair, a next pointer and the cached hash
+    return items.bucket_count() * sizeof(void *) + items.size() * (sizeof(pair<const K, V>) + 2 * sizeof(void *));
+}
+
+template <typename K, typename V>
+size_t heapBytes(const map<K, V> &items)
+{
+    // Red-black tree node: the pair, three pointers and the color
+    return items.size() * (sizeof(pair<const K, V>) + 4 * sizeof(void *));
+}
+
+template <typename K, typename V>
+size_t heapBytes(const multimap<K, V> &items)
+{
+    return items.size() * (sizeof(pair<const K, V>) + 4 * sizeof(void *));
+}
+
+template <typename T>
+size_t heapBytes(const set<T> &items)
+{
+    return items.size() * (sizeof(T) + 4 * sizeof(void *));
+}
+
+inline size_t residentBytes()
+{
+    // Resident set size of the process, 0 where it cannot be read
+#ifdef __linux__
+    ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (statm >> pages >> resident)
+        return resident * sysconf(_SC_PAGESIZE);
+#endif
+    return 0;
+}
+
+// =====================================================
+// Packed Text (plain strings, or interned and front-coded in compact builds)
+// =====================================================
+
+// Chosen when building: with -DLMS_COMPACT_TEXT book texts live in shared pools and a book
+// field is a 4-byte ID; without it every field is an ordinary string
+#ifdef LMS_COMPACT_TEXT
+constexpr bool compactStrings = true;
+#else
+constexpr bool compactStrings = false;
+#endif
+
+class TextReaders
+{
+private:
+    // Lets the pools be read without a lock. A thread bumps its slot to an odd number while
+    // it decodes a text and back to even when done; before a pool frees bytes a read might
+    // still see, it waits for every slot that was odd to move on.
+    struct Slot
     {
-        Book *result = nullptr;
-        for (Book &book : books)
-        {
-            if (book.id == bookID)
-            {
-                result = &book;
-                break;
-            }
-        }
-        return result;
-    }
+        atomic<uint64_t> sequence{0}; // Odd while the owning thread reads
+    };
 
-    vector<Book *> searchBooksByTitle(string titleKeyword)
+    struct Registration
     {
-        vector<Book *> results;
-        for (Book &book : books)
+        Slot slot; // This thread's slot, listed for as long as the thread lives
+
+        Registration()
         {
-            if (book.title.find(titleKeyword) != string::npos)
-            {
-                results.push_back(&book);
-            }
+            lock_guard<mutex> guard(listLock());
+            slots().push_back(&slot);
         }
-        return results;
-    }
 
-    vector<Book *> filterBooksByCategory(string category)
-    {
-        vector<Book *> results;
-        for (Book &book : books)
+        ~Registration()
         {
-            if (book.category == category)
-            {
-                results.push_back(&book);
-            }
+            lock_guard<mutex> guard(listLock());
+            slots().erase(find(slots().begin(), slots().end(), &slot));
         }
-        return results;
+    };
+
+    // Never destroyed, so threads ending during static destruction still find them
+    static mutex &listLock()
+    {
+        static mutex *lock = new mutex;
+        return *lock;
     }
 
-    // =====================================================
-    // Book Management Operations
-    // =====================================================
+    static vector<Slot *> &slots()
+    {
+        static vector<Slot *> *all = new vector<Slot *>;
+        return *all;
+    }
 
-    bool addBook(Book newBook)
+public:
+    class Section
     {
+    private:
+        Slot &slot; // The reading thread's slot
 
-        for (int i = 0; i < books.size(); i++)
+    public:
+        Section() : slot(mine())
         {
-            if (books[i].id == newBook.id)
-            {
-                return false;
-            }
+            slot.sequence.store(slot.sequence.load(memory_order_relaxed) + 1, memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst); // pairs with the fence in waitForReaders
         }
 
-        newBook.availableCopies = newBook.totalCopies;
-        books.push_back(newBook);
+        ~Section()
+        {
+            slot.sequence.store(slot.sequence.load(memory_order_relaxed) + 1, memory_order_release);
+        }
+    };
 
-        return true;
+    static Slot &mine()
+    {
+        thread_local Registration registration;
+        return registration.slot;
     }
 
-    bool updateBookDetails(int bookID, string newTitle, string newAuthor, string newCategory)
+    static void waitForReaders()
     {
-
-        for (int i = 0; i < books.size(); i++)
+        // Returns once every read that may have started before the call has finished; reads
+        // starting later already see what the caller published before calling
+        atomic_thread_fence(memory_order_seq_cst);
+        lock_guard<mutex> guard(listLock());
+        for (Slot *slot : slots())
         {
-            if (books[i].id == bookID)
-            {
-                books[i].title = newTitle;
-                books[i].author = newAuthor;
-                books[i].category = newCategory;
-                return true;
-            }
+            uint64_t seen = slot->sequence.load(memory_order_acquire);
+            while (seen % 2 == 1 && slot->sequence.load(memory_order_acquire) == seen)
+                this_thread::yield();
         }
-
-        return false;
     }
+};
 
-    bool removeBook(int bookID)
+class TextPool
+{
+private:
+    // Used only in compact builds. Texts are interned and reference counted: equal texts
+    // share one ID, and ID 0 is the empty text. They are packed into pages in runs of
+    // frontCodingRun texts, the first whole and each later one as the count of leading
+    // characters it shares with that first one plus the rest, so a read decodes at most two.
+    // Reads take no lock: packed bytes are never changed, an ID's location is swapped
+    // atomically, and old pages or location tables are freed only after waitForReaders.
+    // Once released texts outnumber the live ones the pages are repacked (sorted, which
+    // also shortens the codes) and no ID changes.
+    struct Page
     {
+        unique_ptr<char[]> bytes; // Packed texts
+        size_t size = 0;          // Bytes allocated
+        size_t used = 0;          // Bytes written
+    };
 
-        for (int i = 0; i < books.size(); i++)
-        {
-            if (books[i].id == bookID)
-            {
-                if (books[i].availableCopies != books[i].totalCopies)
-                {
-                    return false;
-                }
-            }
+    vector<Page> pages;                                // Packed texts; a run never spans two pages
+    size_t nextPageBytes = textPageMinBytes;           // Size of the next page, doubling up to textPageBytes
+    const char *runHead = nullptr;                     // First text of the open run
+    string headText;                                   // Its text, which the rest of the run is coded against
+    int runLength = 0;                                 // Texts in the open run
+    atomic<atomic<const char *> *> locations{nullptr}; // ID - 1 -> its packed text; read without the lock
+    uint32_t capacity = 0;                             // Length of locations
+    vector<uint32_t> refs;                             // ID - 1 -> PackedTexts holding it, 0 = free
+    vector<uint32_t> hashOf;                           // ID - 1 -> hash of its text
+    vector<uint32_t> freeIDs;                          // Released IDs, reused first
+    vector<uint32_t> slots;                            // Open-addressing table of live IDs by text hash, 0 = free
+    uint32_t entries = 0;                              // Texts packed into the pages, released ones included
+    uint32_t live = 0;                                 // IDs in use
+    mutable mutex lock;                                // Interning and reference changes; reads never take it
 
-            for (int j = 0; j < reservedBooks.size(); j++)
-            {
-                if (reservedBooks[j].bookID == bookID)
-                {
-                    return false;
-                }
-            }
+    static size_t varintBytes(uint32_t value)
+    {
+        size_t bytes = 1;
+        for (; value >= 0x80; value >>= 7)
+            bytes++;
+        return bytes;
+    }
 
-            books.erase(books.begin() + i);
-            return true;
+    static char *putVarint(char *out, uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            *out++ = char(value | 0x80);
+            value >>= 7;
         }
-
-        return false;
+        *out++ = char(value);
+        return out;
     }
 
-    // =====================================================
-    // Borrowing, Returning & Renewal Operations
-    // =====================================================
+    static uint32_t getVarint(const char *&in)
+    {
+        uint32_t value = 0;
+        for (int shift = 0;; shift += 7)
+        {
+            unsigned char byte = *in++;
+            value |= uint32_t(byte & 0x7f) << shift;
+            if (byte < 0x80)
+                return value;
+        }
+    }
 
-    bool borrowBook(int bookID, string studentID)
+    static void decode(const char *entry, string &out)
     {
-        Book *book = searchBookById(bookID);
-        Student *student = findStudentById(studentID);
+        // An entry is (distance back to its run's head, shared characters, rest length, rest);
+        // a head has distance 0 and shares nothing
+        const char *in = entry;
+        uint32_t distance = getVarint(in);
+        uint32_t shared = getVarint(in);
+        uint32_t rest = getVarint(in);
+        if (distance == 0)
+        {
+            out.assign(in, rest);
+            return;
+        }
+        const char *head = entry - distance + 2; // past the head's two zero varints
+        getVarint(head);
+        out.assign(head, shared);
+        out.append(in, rest);
+    }
 
-        if (!book || !student)
-            return false;
+    const char *location(uint32_t id) const
+    {
+        return locations.load(memory_order_acquire)[id - 1].load(memory_order_acquire);
+    }
 
-        if (book->availableCopies <= 0)
-            return false;
+    void setLocation(uint32_t id, const char *entry)
+    {
+        // Grows the table into a new copy, so readers of the old one can finish undisturbed
+        if (id > capacity)
+        {
+            uint32_t grown = max<uint32_t>(64, capacity * 2);
+            atomic<const char *> *old = locations.load(memory_order_relaxed);
+            atomic<const char *> *table = new atomic<const char *>[grown];
+            for (uint32_t i = 0; i < grown; i++)
+                table[i].store(i < capacity ? old[i].load(memory_order_relaxed) : nullptr, memory_order_relaxed);
+            locations.store(table, memory_order_release);
+            capacity = grown;
+            TextReaders::waitForReaders();
+            delete[] old;
+        }
+        locations.load(memory_order_relaxed)[id - 1].store(entry, memory_order_release);
+    }
 
-        // Find empty loan slot
-        for (int i = 0; i < maxBorrows; i++)
+    const char *append(const string &text)
+    {
+        // Packs the text after the last one and returns where it starts
+        Page *page = pages.empty() ? nullptr : &pages.back();
+        size_t shared = 0, distance = 0, need = 0;
+        bool head = !page || runLength == frontCodingRun;
+        if (!head)
         {
-            if (student->borrowedBooks[i].bookID == 0)
+            while (shared < headText.size() && shared < text.size() && headText[shared] == text[shared])
+                shared++;
+            distance = page->bytes.get() + page->used - runHead;
+            need = varintBytes(distance) + varintBytes(shared) + varintBytes(text.size() - shared) + text.size() - shared;
+            head = need > page->size - page->used;
+        }
+        if (head)
+        {
+            shared = distance = 0;
+            need = 2 + varintBytes(text.size()) + text.size();
+            if (!page || need > page->size - page->used)
             {
-                student->borrowedBooks[i].bookID = bookID;
-                student->borrowedBooks[i].studentID = studentID;
-                student->borrowedBooks[i].returnDate = calculateDueDate(loanDuration);
-
-                book->availableCopies--;
-                return true;
+                pages.emplace_back();
+                page = &pages.back();
+                page->size = max(need, nextPageBytes);
+                page->bytes.reset(new char[page->size]);
+                nextPageBytes = min<size_t>(nextPageBytes * 2, textPageBytes);
             }
         }
 
-        return false; // borrow limit reached
-    };
+        char *entry = page->bytes.get() + page->used;
+        char *out = putVarint(putVarint(putVarint(entry, distance), shared), text.size() - shared);
+        memcpy(out, text.data() + shared, text.size() - shared);
+        page->used += need;
+        if (head)
+        {
+            runHead = entry;
+            headText = text;
+            runLength = 0;
+        }
+        runLength++;
+        entries++;
+        return entry;
+    }
 
-    bool returnBook(int bookID, string studentID, string returnDate)
+    size_t slotOf(uint32_t hashValue, const string &text) const
     {
-        Book *book = searchBookById(bookID);
-        Student *student = findStudentById(studentID);
+        // Slot holding the text's ID, or the free slot ending its probe run
+        thread_local string scratch;
+        size_t mask = slots.size() - 1;
+        size_t slot = hashValue & mask;
+        for (; slots[slot] != 0; slot = (slot + 1) & mask)
+        {
+            if (hashOf[slots[slot] - 1] != hashValue)
+                continue;
+            decode(location(slots[slot]), scratch);
+            if (scratch == text)
+                break;
+        }
+        return slot;
+    }
 
-        if (!book || !student)
-            return false;
+    void place(uint32_t id)
+    {
+        size_t mask = slots.size() - 1;
+        size_t slot = hashOf[id - 1] & mask;
+        while (slots[slot] != 0)
+            slot = (slot + 1) & mask;
+        slots[slot] = id;
+    }
 
-        for (int i = 0; i < maxBorrows; i++)
+    void erase(uint32_t id)
+    {
+        // Removes the ID from the table, shifting later IDs of its probe run back into the gap
+        size_t mask = slots.size() - 1;
+        size_t hole = hashOf[id - 1] & mask;
+        while (slots[hole] != id)
+            hole = (hole + 1) & mask;
+        for (size_t next = (hole + 1) & mask; slots[next] != 0; next = (next + 1) & mask)
         {
-            if (student->borrowedBooks[i].bookID == bookID)
+            size_t home = hashOf[slots[next] - 1] & mask;
+            if (((next - home) & mask) >= ((next - hole) & mask))
             {
-                // Fine calculation (simple)
-                if (returnDate > student->borrowedBooks[i].returnDate)
-                    student->fine += 10;
-
-                // Clear loan record
-                student->borrowedBooks[i].bookID = 0;
-                student->borrowedBooks[i].studentID = "";
-                student->borrowedBooks[i].returnDate = "";
-
-                book->availableCopies++;
-
-                processReservations(bookID);
-                return true;
+                slots[hole] = slots[next];
+                hole = next;
             }
         }
+        slots[hole] = 0;
+    }
 
-        return false; // book not found in student's loans
-    };
-
-    bool renewBook(int bookID, string studentID)
+    void grow()
     {
-        // Check if another student has reserved this book
-        for (const auto &r : reservedBooks)
+        vector<uint32_t> old = move(slots);
+        slots.assign(max<size_t>(64, old.size() * 2), 0);
+        for (uint32_t id : old)
         {
-            if (r.bookID == bookID && r.studentID != studentID)
-                return false;
+            if (id != 0)
+                place(id);
         }
+    }
 
-        Student *student = findStudentById(studentID);
-        if (!student)
-            return false;
-
-        for (int i = 0; i < maxBorrows; i++)
+    void repack()
+    {
+        vector<pair<string, uint32_t>> texts;
+        texts.reserve(live);
+        for (uint32_t id = 1; id <= refs.size(); id++)
         {
-            if (student->borrowedBooks[i].bookID == bookID)
-            {
-                student->borrowedBooks[i].returnDate = calculateDueDate(loanDuration);
-                return true;
-            }
+            if (refs[id - 1] == 0)
+                continue;
+            texts.emplace_back();
+            decode(location(id), texts.back().first);
+            texts.back().second = id;
         }
+        sort(texts.begin(), texts.end());
 
-        return false; // book not borrowed by this student
-    };
+        vector<Page> old = move(pages);
+        pages.clear();
+        nextPageBytes = textPageMinBytes;
+        entries = 0;
+        for (const auto &text : texts)
+            setLocation(text.second, append(text.first));
+        TextReaders::waitForReaders(); // nobody reads the old pages any more
+    }
 
-    // =====================================================
-    // Reservation & Queue-Based Operations
-    // =====================================================
+public:
+    ~TextPool()
+    {
+        delete[] locations.load();
+    }
 
-    bool reserveBook(int bookID, string studentID)
+    uint32_t intern(const string &text)
     {
-        // Check if the student exists
-        Student *student = findStudentById(studentID);
-        if (!student)
+        // ID of the text with one more reference, packing the text if it is not live yet
+        if (text.empty())
+            return 0;
+        lock_guard<mutex> guard(lock);
+        if ((live + 1) * 2 > slots.size())
+            grow();
+
+        uint32_t hashValue = (uint32_t)hash<string>()(text);
+        size_t slot = slotOf(hashValue, text);
+        if (slots[slot] != 0)
         {
-            // Assuming some output or logging, but for now, just return false
-            return false;
+            refs[slots[slot] - 1]++;
+            return slots[slot];
         }
 
-        // Check if the book exists
-        Book *book = searchBookById(bookID);
-        if (!book)
+        uint32_t id;
+        if (!freeIDs.empty())
         {
-            return false;
+            id = freeIDs.back();
+            freeIDs.pop_back();
         }
-
-        // Reservations are only allowed if all copies are currently borrowed
-        if (book->availableCopies > 0)
+        else
         {
-            // Cannot reserve a book that has available copies
-            return false;
+            refs.push_back(0);
+            hashOf.push_back(0);
+            id = refs.size();
         }
+        setLocation(id, append(text));
+        refs[id - 1] = 1;
+        hashOf[id - 1] = hashValue;
+        slots[slot] = id;
+        live++;
+        return id;
+    }
 
-        // Enforce reservation limit: count current reservations for this student
-        int currentReservations = 0;
-        for (const auto &res : reservedBooks)
-        {
-            if (res.studentID == studentID)
-            {
-                currentReservations++;
-            }
-        }
-        if (currentReservations >= maxReserve)
+    uint32_t share(uint32_t id)
+    {
+        if (id != 0)
         {
-            // Student has reached the maximum number of reservations
-            return false;
+            lock_guard<mutex> guard(lock);
+            refs[id - 1]++;
         }
+        return id;
+    }
 
-        // Prevent duplicate reservations: check if the student already reserved this book
-        for (const auto &res : reservedBooks)
+    void release(uint32_t id)
+    {
+        // Drops one reference; the last one frees the ID and, once released texts outnumber
+        // the live ones, the pages are repacked
+        if (id == 0)
+            return;
+        lock_guard<mutex> guard(lock);
+        if (--refs[id - 1] > 0)
+            return;
+        erase(id);
+        freeIDs.push_back(id);
+        live--;
+        if (entries - live > max<uint32_t>(live, frontCodingRun))
+            repack();
+    }
+
+    template <typename Reader>
+    auto read(uint32_t id, Reader reader) const -> decltype(reader(string()))
+    {
+        // Calls reader with the text, decoded into a per-thread buffer, so the reference is
+        // only good until reader returns. The caller must hold a reference to the ID.
+        thread_local string scratch;
         {
-            if (res.bookID == bookID && res.studentID == studentID)
-            {
-                // Already reserved
-                return false;
-            }
+            TextReaders::Section reading;
+            decode(location(id), scratch);
         }
+        return reader(scratch);
+    }
 
-        // Add the reservation to the end of the vector (FIFO queue behavior)
-        Reserve newReserve;
-        newReserve.bookID = bookID;
-        newReserve.studentID = studentID;
-        reservedBooks.push_back(newReserve);
+    uint32_t find(const string &text)
+    {
+        // ID of the text with one more reference if it is live, UINT32_MAX otherwise; never adds it
+        if (text.empty())
+            return 0;
+        lock_guard<mutex> guard(lock);
+        if (slots.empty())
+            return UINT32_MAX;
+        uint32_t id = slots[slotOf((uint32_t)hash<string>()(text), text)];
+        if (id == 0)
+            return UINT32_MAX;
+        refs[id - 1]++;
+        return id;
+    }
 
-        return true;
+    uint32_t liveTexts() const
+    {
+        lock_guard<mutex> guard(lock);
+        return live;
     }
 
-    Reserve *getNextReservation(int bookID)
+    size_t memoryBytes() const
     {
-        // Iterate through the reservations in order (FIFO)
-        for (auto it = reservedBooks.begin(); it != reservedBooks.end(); ++it)
-        {
-            if (it->bookID == bookID)
-            {
+        lock_guard<mutex> guard(lock);
+        size_t bytes = heapBytes(pages) + heapBytes(headText) + capacity * sizeof(atomic<const char *>) +
+                       heapBytes(refs) + heapBytes(hashOf) + heapBytes(freeIDs) + heapBytes(slots);
+        for (const Page &page : pages)
+            bytes += page.size;
+        return bytes;
+    }
+};
 
-                return &(*it);
-            }
-        }
+enum TextPoolID
+{
+    TitleTexts,
+    AuthorTexts,
+    CategoryTexts,
+    DescriptionTexts,
+    NormalizedTexts, // Normalized fields kept by the fuzzy index
+    TextPoolCount
+};
 
-        return nullptr;
+const char *textPoolNames[TextPoolCount] = {"titles", "authors", "categories", "descriptions", "fuzzy texts"};
+
+inline TextPool &textPool(int pool)
+{
+    // Shared by every library in the process. Never destroyed, so texts released during
+    // static destruction still find their pool.
+    static TextPool *pools = new TextPool[TextPoolCount];
+    return pools[pool];
+}
+
+template <int Pool, bool Compact = compactStrings>
+class PackedText
+{
+private:
+    // Plain builds keep an ordinary string. Compact builds intern the text in
+    // textPool(Pool) and keep only its ID, holding one reference. Compact is a parameter
+    // only so that the branches of the other build are not compiled.
+    using Storage = conditional_t<Compact, uint32_t, string>;
+    Storage value{}; // The text, or its ID with 0 = the empty text
+
+    static Storage stored(const string &text)
+    {
+        if constexpr (Compact)
+            return textPool(Pool).intern(text);
+        else
+            return text;
     }
 
-    void processReservations(int bookID)
+    static Storage copied(const Storage &other)
     {
-        // Get the next (earliest) reservation for this book
-        Reserve *nextRes = getNextReservation(bookID);
-        if (!nextRes)
-        {
-            // No reservations to process
-            return;
-        }
+        if constexpr (Compact)
+            return textPool(Pool).share(other);
+        else
+            return other;
+    }
 
-        bool assigned = borrowBook(bookID, nextRes->studentID);
+public:
+    PackedText() {}
+    PackedText(const string &text) : value(stored(text)) {}
+    PackedText(const char *text) : value(stored(text)) {}
+    PackedText(const PackedText &other) : value(copied(other.value)) {}
 
-        if (assigned)
-        {
-            // Remove the fulfilled reservation from the vector
-            for (auto it = reservedBooks.begin(); it != reservedBooks.end(); ++it)
-            {
-                if (it->bookID == bookID && it->studentID == nextRes->studentID)
-                {
-                    reservedBooks.erase(it);
-                    break; // Erase only the first matching one
-                }
-            }
-        }
+    PackedText(PackedText &&other) noexcept : value(move(other.value))
+    {
+        if constexpr (Compact)
+            other.value = 0;
     }
 
-    // =====================================================
-    // Student Management & Fine Handling
-    // =====================================================
+    ~PackedText()
+    {
+        if constexpr (Compact)
+            textPool(Pool).release(value);
+    }
 
-    bool registerStudent(Student newStudent)
+    PackedText &operator=(PackedText other) noexcept
     {
-        // Check if the student ID already exists to ensure uniqueness
-        if (findStudentById(newStudent.id) != nullptr)
-        {
-            // ID is not unique, registration fails
-            return false;
-        }
+        swap(value, other.value);
+        return *this;
+    }
 
-        // Initialize the borrowed books array to ensure no garbage values
-        for (int i = 0; i < maxBorrows; i++)
-        {
-            newStudent.borrowedBooks[i].bookID = 0;
-            newStudent.borrowedBooks[i].studentID = "";
-            newStudent.borrowedBooks[i].returnDate = "";
-        }
+    string str() const
+    {
+        if constexpr (Compact)
+            return read([](const string &text)
+                        { return text; });
+        else
+            return value;
+    }
 
-        // Add the new student to the students vector
-        students.push_back(newStudent);
-        return true;
+    template <typename Reader>
+    auto read(Reader reader) const -> decltype(reader(string()))
+    {
+        // Plain builds hand the string over as it is. Compact builds decode it, so reader
+        // must not keep the reference.
+        static const string emptyText;
+        if constexpr (Compact)
+            return value == 0 ? reader(emptyText) : textPool(Pool).read(value, reader);
+        else
+            return reader(value);
     }
 
-    Student *findStudentById(string studentID)
+    template <typename Predicate>
+    bool matches(Predicate predicate, vector<int8_t> &tested) const
     {
-        // Iterate through the students vector to find the matching ID
-        for (int i = 0; i < students.size(); i++)
+        // read(predicate), except that compact builds test each distinct text once per scan
+        // sharing tested, however many records hold it
+        if constexpr (Compact)
         {
-            if (students[i].id == studentID)
-            {
-                // Found the student, return a pointer to it
-                return &students[i];
-            }
+            if (value >= tested.size())
+                tested.resize(value + 1, -1);
+            if (tested[value] < 0)
+                tested[value] = read(predicate);
+            return tested[value];
         }
-        // Student not found, return nullptr
-        return nullptr;
+        else
+            return predicate(value);
     }
 
-    int calculateTotalFine(string studentID)
+    static bool existing(const string &text, PackedText &found)
     {
-        // Find the student by ID
-        Student *student = findStudentById(studentID);
-        if (!student)
+        // Looks a text up without interning it, so queries do not grow the pool
+        if constexpr (Compact)
         {
-            // Student not found, return 0 as no fine can be calculated
-            return 0;
+            uint32_t foundID = textPool(Pool).find(text);
+            if (foundID == UINT32_MAX)
+                return false;
+            textPool(Pool).release(found.value);
+            found.value = foundID;
         }
+        else
+            found.value = text;
+        return true;
+    }
 
-        // Start with the accumulated fine from past returns
-        int totalFine = student->fine;
+    size_t memoryBytes() const
+    {
+        // Heap held by this text itself; interned texts are counted by their pool
+        if constexpr (Compact)
+            return 0;
+        else
+            return heapBytes(value);
+    }
 
-        // Get the current date to check for overdue books
-        string today = getCurrentDate();
+    bool empty() const { return value == Storage{}; }
+    bool operator==(const PackedText &other) const { return value == other.value; } // compact texts are interned
+    bool operator!=(const PackedText &other) const { return !(*this == other); }
 
-        // Iterate through the borrowed books to calculate potential fines for current overdue books
-        for (int i = 0; i < maxBorrows; i++)
+    bool operator<(const PackedText &other) const
+    {
+        if constexpr (Compact)
         {
-            if (student->borrowedBooks[i].bookID != 0 && today > student->borrowedBooks[i].returnDate)
-            {
-                // Add flat fine of 10 for each overdue book (consistent with returnBook logic)
-                totalFine += 10;
-            }
+            if (value == other.value)
+                return false;
+            string mine = str();
+            return other.read([&](const string &theirs)
+                              { return mine < theirs; });
         }
+        else
+            return value < other.value;
+    }
+
+    bool operator>(const PackedText &other) const { return other < *this; }
 
-        return totalFine;
+    friend ostream &operator<<(ostream &out, const PackedText &text)
+    {
+        return text.read([&](const string &value) -> ostream &
+                         { return out << value; });
     }
+};
 
-    // =====================================================
-    // Reports, Sorting & Persistence Preparation
-    // =====================================================
+struct Reserve
+{
+    int bookID;         // ID of the reserved book
+    string studentID;   // ID of the student who made the reservation
+    string reserveDate; // Date the reservation was made
+};
 
-    vector<Book> getOverdueBooks()
+struct Loan
+{
+    int bookID;        // ID of the borrowed book
+    string studentID;  // ID of the borrowing student
+    string returnDate; // Date when the book was returned (used for fine calculation)
+    string borrowDate; // Date the loan started
+};
+
+struct Book
+{
+    PackedText<TitleTexts> title;             // Book title
+    PackedText<AuthorTexts> author;           // Book author
+    PackedText<CategoryTexts> category;       // Book category or genre
+    PackedText<DescriptionTexts> description; // Short description of the book
+    int id;                                   // Unique book ID
+    int totalCopies;                          // Total copies owned by the library
+    int availableCopies;                      // Copies currently available for borrowing
+    int borrowCount = 0;                      // Times the book has been borrowed (popularity)
+    uint64_t version = 0;                     // Stamp of the last change, for optimistic transactions
+};
+
+struct Student
+{
+    string name;                     // Student name
+    string id;                       // Unique student ID
+    string phoneNumber;              // Student phone number
+    string email;                    // Student email
+    Loan borrowedBooks[maxBorrows];  // Fixed-size array of borrowed books
+    int fine = 0;                    // Total fine owed by the student
+    int patronClass = Undergraduate; // PatronClass, or a registered custom class
+    uint64_t version = 0;            // Stamp of the last change, for optimistic transactions
+};
+
+struct LibrarySnapshot
+{
+    vector<Book> books;                      // Copy of the books at snapshot time
+    vector<Student> students;                // Copy of the students (loans are embedded)
+    vector<Reserve> reservedBooks;           // Copy of the reservation queue
+    vector<RuntimeLoanPolicy> patronClasses; // Copy of the custom patron class policies
+};
+
+struct CheckpointStats
+{
+    long long checkpointsWritten = 0; // Snapshots successfully written to disk
+    long long checkpointFailures = 0; // Snapshots that could not be written
+    long long lastPauseMicros = 0;    // Time the foreground spent copying the last snapshot
+    long long maxPauseMicros = 0;     // Worst foreground pause seen so far
+    long long lastWriteMicros = 0;    // Time the checkpoint thread spent serializing the last snapshot
+};
+
+// =====================================================
+// Text Normalization
+// =====================================================
+
+string normalizeText(const string &text)
+{
+    // Lowercases letters and digits, turns everything else into single spaces
+    string result;
+    for (char c : text)
     {
-        vector<Book> overdueBooks;
-        for (int s = 0; s < students.size(); s++)
+        if (isalnum((unsigned char)c))
         {
-            Student &student = students[s]; // get current student
-
-            // Loop over borrowed books
-            for (int i = 0; i < maxBorrows; i++)
-            {
-                if (student.borrowedBooks[i].bookID != 0)
-                {
-                    // Check if the book is overdue
-                    if (student.borrowedBooks[i].returnDate < getCurrentDate())
-                    {
-                        Book *book = searchBookById(student.borrowedBooks[i].bookID);
-                        if (book)
-                        {
-                            overdueBooks.push_back(*book);
-                        }
-                    }
-                }
-            }
+            result += (char)tolower((unsigned char)c);
+        }
+        else if (!result.empty() && result.back() != ' ')
+        {
+            result += ' ';
         }
-
-        return overdueBooks;
     }
+    if (!result.empty() && result.back() == ' ')
+        result.pop_back();
+    return result;
+}
 
-    void displayOverdueBooks()
+// =====================================================
+// Date Helpers
+// =====================================================
+
+inline tm localTime(time_t when)
+{
+    // localtime() hands every thread the same buffer; workflows stage dates on server workers
+    tm result{};
+#ifdef _WIN32
+    localtime_s(&result, &when);
+#else
+    localtime_r(&when, &result);
+#endif
+    return result;
+}
+
+int dayNumber(const string &date)
+{
+    // Days since 1970-01-01 for a YYYY-MM-DD date, or -1 if it is not a real calendar date
+    static const int monthDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int y, m, d, used = 0;
+    if (sscanf(date.c_str(), "%d-%d-%d%n", &y, &m, &d, &used) != 3 || used != (int)date.size() || m < 1 || m > 12)
+        return -1;
+    bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    if (d < 1 || d > monthDays[m - 1] + (m == 2 && leap))
+        return -1;
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yearOfEra = y - era * 400;
+    int dayOfYear = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+string dateOfDay(int day)
+{
+    // YYYY-MM-DD for a dayNumber() result
+    day += 719468;
+    int era = (day >= 0 ? day : day - 146096) / 146097;
+    int dayOfEra = day - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int shifted = (5 * dayOfYear + 2) / 153; // month counted from March
+    int d = dayOfYear - (153 * shifted + 2) / 5 + 1;
+    int m = shifted < 10 ? shifted + 3 : shifted - 9;
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", yearOfEra + era * 400 + (m <= 2), m, d);
+    return buffer;
+}
+
+// =====================================================
+// Prefix Autocomplete (trie over titles and authors)
+// =====================================================
+
+class TitleAutocomplete
+{
+private:
+    // Radix trie in flat arrays: every edge label is a run of characters stored once in
+    // labels, and a node's children are a sibling list sorted by first character
+    struct Node
     {
-        vector<Book> overdueBooks = getOverdueBooks();
+        uint32_t labelAt = 0, labelLength = 0; // Edge into this node: labels[labelAt, labelAt + labelLength)
+        int firstChild = -1;                   // Child with the smallest first character, -1 for a leaf
+        int nextSibling = -1;                  // Next child of the same parent, -1 if last
+        int firstEnding = -1;                  // Books with a key ending here, a list through endings
+        int topAt = -1;                        // This node's autocompleteTopK slots in tops, -1 for a leaf
+        uint8_t topCount = 0;                  // Slots in use, most popular first
+    };
 
-        if (overdueBooks.empty())
-        {
-            cout << "\nNo overdue books found.\n";
-            return;
-        }
+    struct Ending
+    {
+        int bookID; // Book whose key ends at the node
+        int next;   // Next ending of the same node, -1 if last
+    };
 
-        cout << "\n=========== OVERDUE BOOKS ===========\n";
+    struct Entry
+    {
+        int weight;  // Borrow count
+        string text; // Normalized title and author with '\n' between; the keys are cut from it
+    };
 
-        for (int i = 0; i < overdueBooks.size(); i++)
-        {
-            cout << "\nBook " << i + 1 << ":\n";
-            cout << "-----------------------------------\n";
-            cout << "ID        : " << overdueBooks[i].id << endl;
-            cout << "Title     : " << overdueBooks[i].title << endl;
-            cout << "Author    : " << overdueBooks[i].author << endl;
-            cout << "Category  : " << overdueBooks[i].category << endl;
-            cout << "Available : " << overdueBooks[i].availableCopies
-                 << " / " << overdueBooks[i].totalCopies << endl;
-        }
+    vector<Node> nodes;                // nodes[0] is the root
+    string labels;                     // Edge labels back to back; splits only move offsets
+    vector<Ending> endings;            // Ending lists of every node
+    int freeEnding = -1;               // Released endings, chained through next
+    vector<int> tops;                  // Top lists of inner nodes; leaves rank their endings
+    unordered_map<int, Entry> entries; // Book ID -> weight and key text
+    size_t liveKeys = 0;               // Keys in the trie
+    size_t deadKeys = 0;               // Keys removed since the last rebuild
 
-        cout << "\n====================================\n";
+    bool ranksBefore(int a, int b) const
+    {
+        int weightA = entries.at(a).weight, weightB = entries.at(b).weight;
+        if (weightA != weightB)
+            return weightA > weightB;
+        return a < b;
     }
 
-    void sortBooksByTitle()
+    int best(vector<int> &bookIDs, int k) const
     {
-        int n = books.size();
-        for (int i = 0; i < n - 1; i++)
+        // Moves the k best distinct books to the front, most popular first; returns how many
+        sort(bookIDs.begin(), bookIDs.end());
+        bookIDs.erase(unique(bookIDs.begin(), bookIDs.end()), bookIDs.end());
+        k = min<int>(k, bookIDs.size());
+        partial_sort(bookIDs.begin(), bookIDs.begin() + k, bookIDs.end(), [this](int a, int b)
+                     { return ranksBefore(a, b); });
+        return k;
+    }
+
+    static vector<string> keysOf(const string &text)
+    {
+        // Every suffix starting at a word of the title or the author, so "algo" finds
+        // "Introduction to Algorithms"
+        vector<string> keys;
+        size_t start = 0;
+        while (start < text.size())
         {
-            for (int j = 0; j < n - i - 1; j++)
+            size_t end = min(text.find('\n', start), text.size());
+            for (size_t i = start; i < end; i++)
             {
-                if (books[j].title > books[j + 1].title)
-                {
-                    // swaps the book
-                    Book temp = books[j];
-                    books[j] = books[j + 1];
-                    books[j + 1] = temp;
-                }
+                if (i == start || text[i - 1] == ' ')
+                    keys.push_back(text.substr(i, end - i));
             }
+            start = end + 1;
         }
+        sort(keys.begin(), keys.end());
+        keys.erase(unique(keys.begin(), keys.end()), keys.end());
+        return keys;
     }
 
-    void saveLibraryData()
+    int findChild(int parent, char c) const
     {
-        ofstream file("library_data.txt");
-        if (!file.is_open())
-        {
-            cout << "Failed to open file for saving .\n";
-            return;
-        }
-        // save books
-        file << "Books:\n";
-        for (int i = 0; i < books.size(); i++)
+        for (int child = nodes[parent].firstChild; child >= 0; child = nodes[child].nextSibling)
         {
-            file << books[i].id << ","
-                 << books[i].title << ","
-                 << books[i].author << ","
-                 << books[i].category << ","
-                 << books[i].totalCopies << ","
-                 << books[i].availableCopies << "\n";
+            char first = labels[nodes[child].labelAt];
+            if (first >= c)
+                return first == c ? child : -1;
         }
-        // Step 3: Save students
-        file << "\nStudents:\n";
-        for (int i = 0; i < students.size(); i++)
+        return -1;
+    }
+
+    void linkChild(int parent, int child)
+    {
+        char c = labels[nodes[child].labelAt];
+        int *link = &nodes[parent].firstChild;
+        while (*link >= 0 && labels[nodes[*link].labelAt] < c)
+            link = &nodes[*link].nextSibling;
+        nodes[child].nextSibling = *link;
+        *link = child;
+    }
+
+    int newNode(uint32_t labelAt, uint32_t labelLength)
+    {
+        nodes.push_back(Node());
+        nodes.back().labelAt = labelAt;
+        nodes.back().labelLength = labelLength;
+        return nodes.size() - 1;
+    }
+
+    void addEnding(int nodeIndex, int bookID)
+    {
+        int at = freeEnding;
+        if (at >= 0)
+            freeEnding = endings[at].next;
+        else
         {
-            file << students[i].id << ","
-                 << students[i].name << ","
-                 << students[i].email << ","
-                 << students[i].phoneNumber << ","
-                 << students[i].fine << "\n";
+            at = endings.size();
+            endings.push_back(Ending());
         }
-        // Step 4: Save reservations
-        file << "\nReservations:\n";
-        for (int i = 0; i < reservedBooks.size(); i++)
+        endings[at] = {bookID, nodes[nodeIndex].firstEnding};
+        nodes[nodeIndex].firstEnding = at;
+    }
+
+    bool dropEnding(int nodeIndex, int bookID)
+    {
+        for (int *link = &nodes[nodeIndex].firstEnding; *link >= 0; link = &endings[*link].next)
         {
-            file << reservedBooks[i].bookID << ","
-                 << reservedBooks[i].studentID << "\n";
+            if (endings[*link].bookID == bookID)
+            {
+                int at = *link;
+                *link = endings[at].next;
+                endings[at].next = freeEnding;
+                freeEnding = at;
+                return true;
+            }
         }
-        file.close();
-        cout << "Library data saved successfully \n";
+        return false;
     }
 
-    string calculateDueDate(int daysToAdd)
+    void appendEndings(int nodeIndex, vector<int> &bookIDs) const
     {
-        time_t now = time(0);
-        tm *future = localtime(&now);
+        for (int at = nodes[nodeIndex].firstEnding; at >= 0; at = endings[at].next)
+            bookIDs.push_back(endings[at].bookID);
+    }
 
-        future->tm_mday += daysToAdd;
-        mktime(future); // normalizes date
+    bool inTop(int nodeIndex, int bookID) const
+    {
+        const Node &node = nodes[nodeIndex];
+        if (node.topAt < 0)
+            return false;
+        auto first = tops.begin() + node.topAt;
+        return find(first, first + node.topCount, bookID) != first + node.topCount;
+    }
 
-        char buffer[11];
-        strftime(buffer, sizeof(buffer), "%Y-%m-%d", future);
+    void refresh(int nodeIndex)
+    {
+        // Rebuilds an inner node's list from its own endings and its children's lists: a
+        // book in this node's top k is in the top k of the child it came through
+        vector<int> candidates;
+        appendEndings(nodeIndex, candidates);
+        for (int child = nodes[nodeIndex].firstChild; child >= 0; child = nodes[child].nextSibling)
+        {
+            if (nodes[child].topAt >= 0)
+                candidates.insert(candidates.end(), tops.begin() + nodes[child].topAt,
+                                  tops.begin() + nodes[child].topAt + nodes[child].topCount);
+            else
+                appendEndings(child, candidates);
+        }
 
-        return string(buffer);
+        Node &node = nodes[nodeIndex];
+        if (node.topAt < 0)
+        {
+            node.topAt = tops.size();
+            tops.resize(tops.size() + autocompleteTopK);
+        }
+        node.topCount = best(candidates, autocompleteTopK);
+        copy(candidates.begin(), candidates.begin() + node.topCount, tops.begin() + node.topAt);
     }
 
-    string getCurrentDate()
+    void offer(int nodeIndex, int bookID)
     {
-        time_t now = time(0);
-        tm *ltm = localtime(&now);
-        char buffer[11];
-        strftime(buffer, sizeof(buffer), "%Y-%m-%d", ltm);
-        return string(buffer);
+        // Keeps an inner node's list sorted; weights only grow, so between removals a book
+        // can only join a list or move up in it
+        Node &node = nodes[nodeIndex];
+        int *top = &tops[node.topAt];
+        int at = find(top, top + node.topCount, bookID) - top;
+        if (at == node.topCount)
+        {
+            if (node.topCount == autocompleteTopK && !ranksBefore(bookID, top[at - 1]))
+                return;
+            if (node.topCount < autocompleteTopK)
+                node.topCount++;
+            at = node.topCount - 1;
+            top[at] = bookID;
+        }
+
+        // Bubble the book up to its place
+        while (at > 0 && ranksBefore(top[at], top[at - 1]))
+        {
+            swap(top[at], top[at - 1]);
+            at--;
+        }
     }
 
-    void displayBorrowedBooks(string studentID)
+    void split(int nodeIndex, uint32_t at)
     {
-        Student *student = findStudentById(studentID);
+        // Keeps the first `at` characters of the edge here and moves the rest, with the
+        // children and endings, into a new child
+        int lower = newNode(nodes[nodeIndex].labelAt + at, nodes[nodeIndex].labelLength - at);
+        Node &node = nodes[nodeIndex], &child = nodes[lower];
+        child.firstChild = node.firstChild;
+        child.firstEnding = node.firstEnding;
+        child.topAt = node.topAt;
+        child.topCount = node.topCount;
+        node.labelLength = at;
+        node.firstChild = lower;
+        node.firstEnding = -1;
+        node.topAt = -1;
+        node.topCount = 0;
+        refresh(nodeIndex);
+    }
 
-        if (student == nullptr)
+    vector<int> pathOf(const string &key) const
+    {
+        // Nodes from the root to where an inserted key ends
+        vector<int> path(1, 0);
+        for (size_t i = 0; i < key.size(); i += nodes[path.back()].labelLength)
         {
-            cout << "Student not found.\n";
+            int child = findChild(path.back(), key[i]);
+            if (child < 0)
+                return vector<int>();
+            path.push_back(child);
+        }
+        return path;
+    }
+
+    void insertKey(const string &key, int bookID)
+    {
+        vector<int> path(1, 0);
+        size_t i = 0;
+        while (i < key.size())
+        {
+            int child = findChild(path.back(), key[i]);
+            if (child < 0)
+            {
+                // Nothing shares the rest of the key: it becomes one new edge
+                child = newNode(labels.size(), key.size() - i);
+                labels.append(key, i, string::npos);
+                linkChild(path.back(), child);
+                path.push_back(child);
+                break;
+            }
+
+            uint32_t matched = 1;
+            while (matched < nodes[child].labelLength && i + matched < key.size() &&
+                   labels[nodes[child].labelAt + matched] == key[i + matched])
+                matched++;
+            if (matched < nodes[child].labelLength)
+                split(child, matched);
+            path.push_back(child);
+            i += matched;
+        }
+        addEnding(path.back(), bookID);
+        liveKeys++;
+
+        // Bottom-up, so a node that has just become a parent builds its list from its children's
+        for (int p = path.size() - 1; p >= 0; p--)
+        {
+            if (nodes[path[p]].firstChild < 0)
+                continue;
+            if (nodes[path[p]].topAt < 0)
+                refresh(path[p]);
+            else
+                offer(path[p], bookID);
+        }
+    }
+
+    void removeKey(const string &key, int bookID)
+    {
+        // Only the lists along the key's path that hold the book are rebuilt, bottom-up
+        vector<int> path = pathOf(key);
+        if (path.empty() || !dropEnding(path.back(), bookID))
             return;
+        liveKeys--;
+        deadKeys++;
+        for (int p = path.size() - 1; p >= 0; p--)
+        {
+            if (inTop(path[p], bookID))
+                refresh(path[p]);
         }
+    }
 
-        bool hasBorrowed = false;
+    void rebuild()
+    {
+        // Removed keys leave their nodes and labels behind; start over once they outnumber the live ones
+        unordered_map<int, Entry> kept = move(entries);
+        *this = TitleAutocomplete();
+        entries = move(kept);
+        for (const auto &entry : entries)
+        {
+            for (const string &key : keysOf(entry.second.text))
+                insertKey(key, entry.first);
+        }
+    }
 
-        cout << "\nBorrowed Books for Student ID: " << studentID << endl;
+public:
+    TitleAutocomplete()
+    {
+        nodes.push_back(Node());
+    }
 
-        for (int i = 0; i < maxBorrows; i++)
+    void addBook(const Book &book)
+    {
+        Entry &entry = entries[book.id];
+        entry.weight = book.borrowCount;
+        entry.text = normalizeText(book.title.str()) + '\n' + normalizeText(book.author.str());
+        for (const string &key : keysOf(entry.text))
+            insertKey(key, book.id);
+    }
+
+    void removeBook(int bookID)
+    {
+        auto found = entries.find(bookID);
+        if (found == entries.end())
+            return;
+        for (const string &key : keysOf(found->second.text))
+            removeKey(key, bookID);
+        entries.erase(bookID);
+        if (deadKeys > liveKeys)
+            rebuild();
+    }
+
+    void updateBook(const Book &book)
+    {
+        removeBook(book.id);
+        addBook(book);
+    }
+
+    void recordBorrow(int bookID)
+    {
+        // One more borrow: the book can only move up in the lists along its keys
+        auto found = entries.find(bookID);
+        if (found == entries.end())
+            return;
+        found->second.weight++;
+        for (const string &key : keysOf(found->second.text))
         {
-            if (student->borrowedBooks[i].bookID != 0)
+            for (int nodeIndex : pathOf(key))
             {
-                hasBorrowed = true;
-                cout << "Book ID: " << student->borrowedBooks[i].bookID
-                     << " | Return Date: " << student->borrowedBooks[i].returnDate
-                     << endl;
+                if (nodes[nodeIndex].topAt >= 0)
+                    offer(nodeIndex, bookID);
             }
         }
+    }
 
-        if (!hasBorrowed)
+    vector<int> complete(const string &prefix, int k) const
+    {
+        // Top-k book IDs whose title or author (or a word in them) starts with the prefix;
+        // a prefix ending partway along an edge still names that edge's subtree
+        string key = normalizeText(prefix);
+        int current = 0;
+        for (size_t i = 0; i < key.size();)
         {
-            cout << "No books currently borrowed.\n";
+            current = findChild(current, key[i]);
+            if (current < 0)
+                return vector<int>();
+            size_t length = min<size_t>(nodes[current].labelLength, key.size() - i);
+            if (labels.compare(nodes[current].labelAt, length, key, i, length) != 0)
+                return vector<int>();
+            i += length;
+        }
+
+        vector<int> bookIDs;
+        const Node &node = nodes[current];
+        if (node.topAt >= 0)
+            bookIDs.assign(tops.begin() + node.topAt, tops.begin() + node.topAt + node.topCount);
+        else
+        {
+            appendEndings(current, bookIDs);
+            bookIDs.resize(best(bookIDs, autocompleteTopK));
         }
+        bookIDs.resize(min<int>(k, bookIDs.size()));
+        return bookIDs;
     }
 
-    // =====================================================
-    // Menu System & Quality-of-Life Utilities
-    // =====================================================
+    size_t memoryBytes() const
+    {
+        size_t bytes = heapBytes(nodes) + heapBytes(labels) + heapBytes(endings) + heapBytes(tops) + heapBytes(entries);
+        for (const auto &entry : entries)
+            bytes += heapBytes(entry.second.text);
+        return bytes;
+    }
+};
 
-    void displayMainMenu()
+// =====================================================
+// Fuzzy Search (n-gram candidates, bit-parallel edit distance)
+// =====================================================
+
+enum FuzzyField
+{
+    FuzzyTitle,
+    FuzzyAuthor,
+    FuzzyDescription,
+    FuzzyFieldCount
+};
+
+struct FuzzyMatch
+{
+    int bookID;   // Matching book
+    int distance; // Fewest edits turning the query into part of the title, author or description
+};
+
+class FuzzyIndex
+{
+private:
+    // A posting is slot << 2 | window. Window w < 3 of a field holds the bigrams and trigrams
+    // lying wholly inside characters [w * step, w * step + 2 * step), window 3 those from
+    // 3 * step on. Any match spanning at most step + 1 characters lies inside one window, so
+    // the grams it keeps are counted together and only that window needs checking. Titles and
+    // authors fit in window 0.
+    static const int windowCount = 4;
+    static const int probeCost = 8;   // Postings counted in the time a galloping probe takes
+    static const int verifyCost = 64; // ...and in the time a candidate is checked
+
+    struct Entry
     {
-        int choice;
+        int bookID = -1;                                     // Indexed book, -1 once removed
+        PackedText<NormalizedTexts> fields[FuzzyFieldCount]; // Normalized title, author and description
+        uint16_t lengths[FuzzyFieldCount] = {};              // Their lengths, for the length filter
+    };
 
-        cout << "\nWelcome to the Library Management System" << endl;
-        cout << "Please select your role:" << endl;
-        cout << "1. Admin" << endl;
-        cout << "2. Student" << endl;
-        cout << "0. Exit" << endl;
-        cout << "Enter your choice: ";
+    struct Cursor
+    {
+        const vector<uint32_t> *list; // Postings of one query gram
+        size_t at;                    // Next posting to look at
+        int weight;                   // Query positions holding the gram
+    };
 
-        cin >> choice;
-        cin.ignore();
+    vector<Entry> slots;                                                  // Books in the order they were indexed; postings name them by slot
+    unordered_map<int, int> slotOf;                                       // Book ID -> slot
+    unordered_map<uint32_t, vector<uint32_t>> postings[FuzzyFieldCount]; // Per field: bigram or trigram -> postings, ascending
 
-        handleUserChoice(choice);
+    static uint32_t gramAt(const string &text, int at, int size)
+    {
+        // Normalized text has no zero bytes, so bigrams and trigrams never share a value
+        uint32_t gram = 0;
+        for (int j = 0; j < size; j++)
+            gram = (gram << 8) | (unsigned char)text[at + j];
+        return gram;
     }
 
-    void handleUserChoice(int choice)
+    static int windowBegin(int window)
     {
-        if (choice == 0)
-        {
-            cout << "Exiting the system. Goodbye!" << endl;
-            return;
-        }
-        else if (choice == 1)
+        return window * fuzzyWindowStep;
+    }
+
+    static int windowEnd(int window, int length)
+    {
+        return window == windowCount - 1 ? length : min(length, windowBegin(window) + 2 * fuzzyWindowStep);
+    }
+
+    static vector<pair<uint32_t, uint32_t>> postingsOf(const string &text, uint32_t slot)
+    {
+        // (gram, posting) for every bigram and trigram of one field, once per window holding it
+        vector<pair<uint32_t, uint32_t>> result;
+        for (int size = 2; size <= 3; size++)
         {
-            // Admin role
-            handleAdminMenu();
+            for (int at = 0; at + size <= (int)text.size(); at++)
+            {
+                for (int window = min(at / fuzzyWindowStep, windowCount - 1); window >= 0 && at + size <= windowEnd(window, text.size()); window--)
+                    result.push_back({gramAt(text, at, size), slot << 2 | window});
+            }
         }
-        else if (choice == 2)
+        sort(result.begin(), result.end());
+        result.erase(unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
+    struct Pattern
+    {
+        string text;                // Normalized query
+        array<uint64_t, 256> peq{}; // Bit i set where text[i] is the character (Myers' Peq table)
+    };
+
+    static int searchDistance(const Pattern &pattern, const string &text, int begin, int end)
+    {
+        // Myers' bit-parallel algorithm: the smallest edit distance between the pattern and any
+        // substring of text[begin, end), one 64-bit word per text character
+        int m = pattern.text.size();
+        if (m > 64)
+            return searchDistanceDP(pattern.text, text.substr(begin, end - begin));
+
+        uint64_t pv = ~0ULL, mv = 0, last = 1ULL << (m - 1);
+        int score = m, best = m;
+        for (int i = begin; i < end; i++)
         {
-            // Student role
-            handleStudentMenu();
+            uint64_t eq = pattern.peq[(unsigned char)text[i]];
+            uint64_t xv = eq | mv;
+            uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            uint64_t ph = mv | ~(xh | pv);
+            uint64_t mh = pv & xh;
+            if (ph & last)
+                score++;
+            else if (mh & last)
+                score--;
+            ph <<= 1; // no carry-in: a match may start anywhere in the text
+            mh <<= 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+            best = min(best, score);
         }
-        else
+        return best;
+    }
+
+    static void seek(Cursor &cursor, uint32_t key, int shift)
+    {
+        // Galloping search: moves the cursor to the first posting whose key is at least key
+        const vector<uint32_t> &list = *cursor.list;
+        size_t end = cursor.at;
+        for (size_t step = 1; end < list.size() && (list[end] >> shift) < key; step *= 2)
         {
-            cout << "Invalid choice. Please try again." << endl;
+            cursor.at = end + 1;
+            end += step;
         }
+        cursor.at = lower_bound(list.begin() + cursor.at, list.begin() + min(end, list.size()), key,
+                                [shift](uint32_t posting, uint32_t key)
+                                { return (posting >> shift) < key; }) -
+                    list.begin();
     }
-    // Handles user menu selection and calls the corresponding system operation.
 
-    // Helper function for Admin menu (not part of public interface)
-    void handleAdminMenu()
+    struct Filter
     {
-        int adminChoice;
-        do
+        int distance = -1;     // Edits the filter admits
+        int gramSize = 0;      // 3 or 2, or 0 when neither filter applies and every book is checked
+        int required = 0;      // Query gram positions a candidate keeps at least
+        int shift = 0;         // Postings compare by slot and window, or by slot alone when 2
+        vector<Cursor> sparse; // Lists counted a block at a time
+        vector<Cursor> dense;  // Lists probed for the candidates, rarest first
+        int denseWeight = 0;   // Query positions of the probed lists together
+    };
+
+    Filter chooseFilter(const string &query, int field, int distance) const
+    {
+        // q-gram lemma: each edit destroys at most q of the query's m - q + 1 gram positions,
+        // so a match within the distance keeps `required` of them. The most common lists, as
+        // many as cannot reach `required` on their own, need not be counted: they are probed
+        // for the candidates the rarer lists name, unless counting them is cheaper than the
+        // probes. Takes the trigram or bigram filter, whichever demands at least one gram and
+        // costs less, counting the candidates each would pass as if grams were independent.
+        // A match that could be longer than a window is counted by slot, adding up its
+        // windows: that only admits more candidates.
+        int m = query.size();
+        Filter filter;
+        filter.distance = distance;
+        filter.shift = m + distance <= fuzzyWindowStep + 1 ? 0 : 2;
+        size_t chosenCost = 0;
+        for (int size = 3; size >= 2; size--)
         {
-            cout << "\nAdmin Menu:" << endl;
-            cout << "1. Add Book" << endl;
-            cout << "2. Update Book Details" << endl;
-            cout << "3. Remove Book" << endl;
-            cout << "4. Register Student" << endl;
-            cout << "5. Display All Books" << endl;
-            cout << "6. Sort Books by Title" << endl;
-            cout << "7. Save Library Data" << endl;
-            cout << "8. Show all overdue books" << endl;
-            cout << "0. Back to Main Menu" << endl;
-            cout << "Enter your choice: ";
-            cin >> adminChoice;
-            cin.ignore(); // Clear input buffer
+            int need = (m - size + 1) - distance * size;
+            if (need <= 0)
+                continue;
+            vector<uint32_t> grams;
+            for (int at = 0; at + size <= m; at++)
+                grams.push_back(gramAt(query, at, size));
+            sort(grams.begin(), grams.end());
 
-            switch (adminChoice)
-            {
-            case 1:
+            vector<Cursor> lists;
+            int total = 0;
+            for (size_t i = 0, run; i < grams.size(); i += run)
             {
-                Book newBook;
-                cout << "Enter Book ID: ";
-                cin >> newBook.id;
-                cin.ignore();
-                cout << "Enter Title: ";
-                getline(cin, newBook.title);
-                cout << "Enter Author: ";
-                getline(cin, newBook.author);
-                cout << "Enter Category: ";
-                getline(cin, newBook.category);
-                cout << "Enter Description: ";
-                getline(cin, newBook.description);
-                cout << "Enter Total Copies: ";
-                cin >> newBook.totalCopies;
-                newBook.availableCopies = newBook.totalCopies;
-                if (addBook(newBook))
-                {
-                    cout << "Book added successfully." << endl;
-                }
-                else
+                run = upper_bound(grams.begin() + i, grams.end(), grams[i]) - (grams.begin() + i);
+                auto list = postings[field].find(grams[i]);
+                if (list != postings[field].end())
                 {
-                    cout << "Failed to add book." << endl;
+                    lists.push_back({&list->second, 0, (int)run});
+                    total += run;
                 }
-                break;
             }
-            case 2:
+            if (total < need)
+                lists.clear(); // No book keeps enough of these grams: nothing to scan
+            sort(lists.begin(), lists.end(), [](const Cursor &a, const Cursor &b)
+                 { return a.list->size() > b.list->size(); });
+            int weight = 0;
+            size_t split = 0, counted = 0;
+            while (split < lists.size() && weight + lists[split].weight < need)
+                weight += lists[split++].weight;
+            for (size_t i = split; i < lists.size(); i++)
+                counted += lists[i].list->size();
+            size_t probes = counted * probeCost;
+            while (split > 0 && lists[split - 1].list->size() <= probes)
             {
-                int bookID;
-                string newTitle, newAuthor, newCategory;
-                cout << "Enter Book ID to update: ";
-                cin >> bookID;
-                cin.ignore();
-                cout << "Enter New Title: ";
-                getline(cin, newTitle);
-                cout << "Enter New Author: ";
-                getline(cin, newAuthor);
-                cout << "Enter New Category: ";
-                getline(cin, newCategory);
-                if (updateBookDetails(bookID, newTitle, newAuthor, newCategory))
-                {
-                    cout << "Book updated successfully." << endl;
-                }
-                else
-                {
-                    cout << "Failed to update book. Book with ID not found!" << endl;
-                }
-                break;
+                weight -= lists[--split].weight;
+                counted += lists[split].list->size();
             }
-            case 3:
+
+            vector<double> spread(need + 1, 0); // Chance a book holds lists of each total weight, `need` or more last
+            spread[0] = 1;
+            for (const Cursor &list : lists)
             {
-                int bookID;
-                cout << "Enter Book ID to remove: ";
-                cin >> bookID;
-                if (removeBook(bookID))
-                {
-                    cout << "Book removed successfully." << endl;
-                }
-                else
+                double held = min(1.0, (double)list.list->size() / max<size_t>(1, slots.size()));
+                for (int count = need - 1; count >= 0; count--)
                 {
-                    cout << "Failed to remove book." << endl;
+                    spread[min(need, count + list.weight)] += spread[count] * held;
+                    spread[count] *= 1 - held;
                 }
-                break;
             }
-            case 4:
+            size_t cost = counted + probes * split + (size_t)(spread[need] * slots.size() * verifyCost);
+
+            if (filter.gramSize == 0 || cost < chosenCost)
             {
-                Student newStudent;
-                cout << "Enter Student ID: ";
-                getline(cin, newStudent.id);
-                cout << "Enter Name: ";
-                getline(cin, newStudent.name);
-                cout << "Enter Phone Number: ";
-                getline(cin, newStudent.phoneNumber);
-                cout << "Enter Email: ";
-                getline(cin, newStudent.email);
-                if (registerStudent(newStudent))
-                {
-                    cout << "Student registered successfully." << endl;
-                }
-                else
-                {
-                    cout << "Failed to register student." << endl;
-                }
-                break;
+                chosenCost = cost;
+                filter.gramSize = size;
+                filter.required = need;
+                filter.dense.assign(lists.rbegin() + (lists.size() - split), lists.rend());
+                filter.sparse.assign(lists.begin() + split, lists.end());
+                filter.denseWeight = weight;
             }
-            case 5:
+        }
+        return filter;
+    }
+
+    void scanField(const Pattern &pattern, int field, int maxDistance, int k, vector<pair<int, int>> &closest) const
+    {
+        // Offers closest, the (distance, slot) pairs of the k best books so far in that order,
+        // every book whose field lies within maxDistance of the query. Books are visited in
+        // slot order, so once closest is full a later book must beat its last entry: the
+        // edits allowed only shrink, and the filter is rebuilt for the fewer edits.
+        int m = pattern.text.size();
+        auto allowed = [&](uint32_t slot)
+        {
+            if ((int)closest.size() < k)
+                return maxDistance;
+            return min(maxDistance, closest.back().first - ((int)slot < closest.back().second ? 0 : 1));
+        };
+        auto offer = [&](int distance, int slot)
+        {
+            auto same = find_if(closest.begin(), closest.end(), [slot](const pair<int, int> &entry)
+                                { return entry.second == slot; });
+            if (same != closest.end())
             {
-                displayAllBooks();
+                if (same->first <= distance)
+                    return;
+                closest.erase(same);
+            }
+            closest.insert(upper_bound(closest.begin(), closest.end(), make_pair(distance, slot)), make_pair(distance, slot));
+            if ((int)closest.size() > k)
+                closest.pop_back();
+        };
+        auto check = [&](uint32_t slot, int window, int limit)
+        {
+            const Entry &entry = slots[slot];
+            if (entry.bookID < 0 || entry.lengths[field] < m - limit)
+                return;
+            int distance = entry.fields[field].read([&](const string &text)
+                                                    {
+                int begin = window < 0 ? 0 : windowBegin(window);
+                int end = window < 0 ? text.size() : windowEnd(window, text.size());
+                return end - begin < m - limit ? limit + 1 : searchDistance(pattern, text, begin, end); });
+            if (distance <= limit)
+                offer(distance, slot);
+        };
+
+        thread_local vector<int> counts(fuzzyBlockKeys, 0);
+        Filter filter;
+        uint32_t position = 0; // Slot the scan has reached
+        while (position < slots.size())
+        {
+            int limit = allowed(position);
+            if (limit < 0)
                 break;
+            if (limit != filter.distance)
+            {
+                filter = chooseFilter(pattern.text, field, limit);
+                uint32_t key = filter.shift == 0 ? position << 2 : position;
+                for (Cursor &cursor : filter.sparse)
+                    seek(cursor, key, filter.shift);
+                for (Cursor &cursor : filter.dense)
+                    seek(cursor, key, filter.shift);
             }
-            case 6:
+
+            if (filter.gramSize == 0)
             {
-                sortBooksByTitle();
-                cout << "Books sorted by title." << endl;
-                break;
+                // Query too short for either filter to prune safely; check every book
+                uint32_t end = min<size_t>(slots.size(), position + fuzzyBlockKeys);
+                for (; position < end && allowed(position) >= 0; position++)
+                    check(position, -1, allowed(position));
+                continue;
             }
-            case 7:
+
+            // Postings are counted a block of keys at a time; the scan then checks the block's
+            // candidates in order
+            int shift = filter.shift;
+            uint64_t low = UINT64_MAX;
+            for (const Cursor &cursor : filter.sparse)
             {
-                saveLibraryData();
-                cout << "Library data saved." << endl;
-                break;
+                if (cursor.at < cursor.list->size())
+                    low = min<uint64_t>(low, (*cursor.list)[cursor.at] >> shift);
             }
-            case 8:
-                displayOverdueBooks();
+            if (low == UINT64_MAX)
                 break;
-            case 0:
-                displayMainMenu();
+            uint64_t high = low + fuzzyBlockKeys;
+            for (Cursor &cursor : filter.sparse)
+            {
+                const vector<uint32_t> &list = *cursor.list;
+                for (; cursor.at < list.size() && (list[cursor.at] >> shift) < high; cursor.at++)
+                    counts[(list[cursor.at] >> shift) - low] += cursor.weight;
+            }
+
+            for (int offset = 0; offset < fuzzyBlockKeys; offset++)
+            {
+                int count = counts[offset];
+                if (count == 0)
+                    continue;
+                counts[offset] = 0;
+                uint32_t key = low + offset;
+                uint32_t slot = shift == 0 ? key >> 2 : key;
+                int slotLimit = allowed(slot);
+                int required = filter.required + (filter.distance - slotLimit) * filter.gramSize;
+                if (slotLimit < 0 || count + filter.denseWeight < required)
+                    continue;
+                int unseen = filter.denseWeight;
+                for (size_t i = 0; i < filter.dense.size() && count < required && count + unseen >= required; i++)
+                {
+                    Cursor &cursor = filter.dense[i];
+                    unseen -= cursor.weight;
+                    seek(cursor, key, shift);
+                    if (cursor.at < cursor.list->size() && ((*cursor.list)[cursor.at] >> shift) == key)
+                        count += cursor.weight;
+                }
+                if (count >= required)
+                    check(slot, shift == 0 ? (int)(key & 3) : -1, slotLimit);
+            }
+            position = shift == 0 ? high >> 2 : high;
+        }
+    }
+
+public:
+    static int searchDistanceDP(const string &pattern, const string &text)
+    {
+        // Same result as searchDistance for patterns longer than a machine word; also the
+        // brute-force reference the fuzzy benchmark checks the index against
+        int m = pattern.size();
+        vector<int> column(m + 1);
+        for (int i = 0; i <= m; i++)
+            column[i] = i;
+        int best = m;
+        for (char c : text)
+        {
+            int diagonal = 0; // row 0 stays 0: free start
+            for (int i = 1; i <= m; i++)
+            {
+                int above = column[i];
+                column[i] = min({column[i] + 1, column[i - 1] + 1, diagonal + (pattern[i - 1] != c)});
+                diagonal = above;
+            }
+            best = min(best, column[m]);
+        }
+        return best;
+    }
+
+    static int defaultDistance(int length)
+    {
+        // Edits allowed for a query of this many normalized characters. Every budget leaves
+        // the bigram filter at least one shared bigram to demand from queries of 2 or more
+        // characters, so only single-character queries verify every book.
+        return length <= 3 ? 0 : (length <= 5 ? 1 : (length <= 8 ? 2 : 3));
+    }
+
+    void addBook(const Book &book)
+    {
+        // Slots are never reused, so a new book's postings go at the end of every list
+        uint32_t slot = slots.size();
+        slots.push_back(Entry());
+        Entry &entry = slots.back();
+        entry.bookID = book.id;
+        string fields[FuzzyFieldCount] = {normalizeText(book.title.str()), normalizeText(book.author.str()), normalizeText(book.description.str())};
+        for (int f = 0; f < FuzzyFieldCount; f++)
+        {
+            entry.fields[f] = fields[f];
+            entry.lengths[f] = min<size_t>(fields[f].size(), UINT16_MAX);
+            for (const auto &posting : postingsOf(fields[f], slot))
+                postings[f][posting.first].push_back(posting.second);
+        }
+        slotOf[book.id] = slot;
+    }
+
+    void removeBook(int bookID)
+    {
+        auto found = slotOf.find(bookID);
+        if (found == slotOf.end())
+            return;
+        uint32_t slot = found->second;
+        Entry &entry = slots[slot];
+        for (int f = 0; f < FuzzyFieldCount; f++)
+        {
+            vector<pair<uint32_t, uint32_t>> grams = postingsOf(entry.fields[f].str(), slot);
+            for (size_t i = 0; i < grams.size(); i++)
+            {
+                if (i > 0 && grams[i].first == grams[i - 1].first)
+                    continue;
+                vector<uint32_t> &list = postings[f][grams[i].first];
+                list.erase(lower_bound(list.begin(), list.end(), slot << 2), upper_bound(list.begin(), list.end(), slot << 2 | 3));
+                if (list.empty())
+                    postings[f].erase(grams[i].first);
+            }
+        }
+        entry = Entry();
+        slotOf.erase(found);
+    }
+
+    void updateBook(const Book &book)
+    {
+        removeBook(book.id);
+        addBook(book);
+    }
+
+    vector<FuzzyMatch> search(const string &query, int maxDistance, bool withDescriptions = false, int k = fuzzyTopK) const
+    {
+        // The k books closest to the query in title or author, and description if asked, ties
+        // in the order the books were indexed
+        Pattern pattern;
+        pattern.text = normalizeText(query);
+        int m = pattern.text.size();
+        vector<FuzzyMatch> matches;
+        if (m == 0 || k <= 0)
+            return matches;
+        for (int i = 0; i < min(m, 64); i++)
+            pattern.peq[(unsigned char)pattern.text[i]] |= 1ULL << i;
+
+        vector<pair<int, int>> closest; // (distance, slot) of the best books so far, best first
+        int fields = withDescriptions ? FuzzyFieldCount : FuzzyDescription;
+        for (int field = 0; field < fields; field++)
+            scanField(pattern, field, maxDistance, k, closest);
+        for (const auto &entry : closest)
+            matches.push_back({slots[entry.second].bookID, entry.first});
+        return matches;
+    }
+
+    size_t memoryBytes() const
+    {
+        // In compact builds the normalized texts themselves live in textPool(NormalizedTexts)
+        size_t bytes = heapBytes(slots) + heapBytes(slotOf);
+        for (const Entry &entry : slots)
+        {
+            for (const auto &field : entry.fields)
+                bytes += field.memoryBytes();
+        }
+        for (const auto &field : postings)
+        {
+            bytes += heapBytes(field);
+            for (const auto &list : field)
+                bytes += heapBytes(list.second);
+        }
+        return bytes;
+    }
+};
+
+// =====================================================
+// Full-Text Search over Descriptions (BM25)
+// =====================================================
+
+struct TextMatch
+{
+    int bookID;   // Matching book
+    double score; // BM25 score, higher is better
+};
+
+class DescriptionIndex
+{
+private:
+    struct PostingList
+    {
+        vector<uint8_t> bytes;     // Varint (docDelta, termFrequency) pairs
+        vector<int> blockFirstDoc; // First document of every block, for skipping
+        vector<int> blockOffset;   // Byte offset of every block
+        int count = 0;             // Number of postings
+        int lastDoc = -1;          // Last document appended
+    };
+
+    struct Cursor
+    {
+        const PostingList *list; // List being read
+        double upperBound;       // Highest score a posting of this term can contribute
+        double idf;              // Inverse document frequency of the term
+        int index = -1;          // Position of the current posting
+        size_t offset = 0;       // Byte offset of the next posting
+        int doc = -1;            // Current document, INT_MAX when exhausted
+        int tf = 0;              // Term frequency in the current document
+    };
+
+    unordered_map<string, PostingList> postings; // Term -> documents containing it
+    vector<int> docBook;                         // Document number -> book ID
+    vector<int> docLength;                       // Document number -> words in the description
+    vector<bool> deleted;                        // Documents of removed books
+    unordered_map<int, int> docOfBook;           // Book ID -> live document number
+    long long totalLength = 0;                   // Words over all live documents
+    int liveDocs = 0;                            // Documents not deleted
+    mutable shared_mutex lock;                   // Queries share it, updates take it alone
+
+    static void putVarint(vector<uint8_t> &bytes, uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            bytes.push_back((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        bytes.push_back(value);
+    }
+
+    static uint32_t getVarint(const vector<uint8_t> &bytes, size_t &offset)
+    {
+        uint32_t value = 0;
+        for (int shift = 0;; shift += 7)
+        {
+            uint8_t byte = bytes[offset++];
+            value |= (uint32_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+    }
+
+    static void append(PostingList &list, int doc, int tf)
+    {
+        // Every block starts with an absolute document number so it can be decoded on its own
+        if (list.count % postingBlockSize == 0)
+        {
+            list.blockFirstDoc.push_back(doc);
+            list.blockOffset.push_back(list.bytes.size());
+            putVarint(list.bytes, doc);
+        }
+        else
+        {
+            putVarint(list.bytes, doc - list.lastDoc);
+        }
+        putVarint(list.bytes, tf);
+        list.lastDoc = doc;
+        list.count++;
+    }
+
+    static void next(Cursor &c)
+    {
+        c.index++;
+        if (c.index >= c.list->count)
+        {
+            c.doc = INT_MAX;
+            return;
+        }
+        uint32_t value = getVarint(c.list->bytes, c.offset);
+        c.doc = (c.index % postingBlockSize == 0) ? (int)value : c.doc + (int)value;
+        c.tf = getVarint(c.list->bytes, c.offset);
+    }
+
+    static void advanceTo(Cursor &c, int target)
+    {
+        // Jump over whole blocks that end before the target, then decode forward
+        const PostingList &list = *c.list;
+        int block = max(0, c.index) / postingBlockSize;
+        int lastBlock = block;
+        while (lastBlock + 1 < (int)list.blockFirstDoc.size() && list.blockFirstDoc[lastBlock + 1] <= target)
+            lastBlock++;
+        if (lastBlock > block || c.index < 0)
+        {
+            c.index = lastBlock * postingBlockSize - 1;
+            c.offset = list.blockOffset[lastBlock];
+            next(c);
+        }
+        while (c.doc < target)
+            next(c);
+    }
+
+    static vector<string> tokenize(const string &text)
+    {
+        vector<string> words;
+        stringstream stream(normalizeText(text));
+        string word;
+        while (stream >> word)
+            words.push_back(word);
+        return words;
+    }
+
+    double termScore(const Cursor &c) const
+    {
+        double averageLength = liveDocs ? (double)totalLength / liveDocs : 1.0;
+        double norm = bm25K1 * (1 - bm25B + bm25B * docLength[c.doc] / averageLength);
+        return c.idf * c.tf * (bm25K1 + 1) / (c.tf + norm);
+    }
+
+public:
+    void addBook(const Book &book)
+    {
+        unique_lock<shared_mutex> guard(lock);
+        vector<string> words = tokenize(book.description.str());
+        int doc = docBook.size();
+        docBook.push_back(book.id);
+        docLength.push_back(words.size());
+        deleted.push_back(false);
+        docOfBook[book.id] = doc;
+        totalLength += words.size();
+        liveDocs++;
+
+        map<string, int> frequency;
+        for (const string &word : words)
+            frequency[word]++;
+        for (auto &term : frequency)
+            append(postings[term.first], doc, term.second);
+    }
+
+    void removeBook(int bookID)
+    {
+        // Removal leaves a tombstone; rebuild() drops them
+        unique_lock<shared_mutex> guard(lock);
+        auto found = docOfBook.find(bookID);
+        if (found == docOfBook.end())
+            return;
+        deleted[found->second] = true;
+        totalLength -= docLength[found->second];
+        liveDocs--;
+        docOfBook.erase(found);
+    }
+
+    size_t memoryBytes() const
+    {
+        shared_lock<shared_mutex> guard(lock);
+        size_t bytes = heapBytes(postings) + heapBytes(docBook) + heapBytes(docLength) + heapBytes(deleted) + heapBytes(docOfBook);
+        for (const auto &term : postings)
+        {
+            const PostingList &list = term.second;
+            bytes += heapBytes(term.first) + heapBytes(list.bytes) + heapBytes(list.blockFirstDoc) + heapBytes(list.blockOffset);
+        }
+        return bytes;
+    }
+
+    bool needsCompaction() const
+    {
+        shared_lock<shared_mutex> guard(lock);
+        return docBook.size() > 64 && liveDocs * 2 < (int)docBook.size();
+    }
+
+    void rebuild(const vector<Book> &books, int threads = thread::hardware_concurrency())
+    {
+        // Bulk build: threads tokenize contiguous ranges of books, then each thread encodes
+        // the terms hashed to it, so every posting list is still written in document order
+        threads = max(1, min<int>(threads, books.size() / 256 + 1));
+        vector<map<string, vector<pair<int, int>>>> local(threads);
+        vector<int> lengths(books.size());
+        vector<thread> workers;
+        for (int t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&, t]
+                                 {
+                size_t begin = books.size() * t / threads, end = books.size() * (t + 1) / threads;
+                for (size_t doc = begin; doc < end; doc++)
+                {
+                    vector<string> words = tokenize(books[doc].description.str());
+                    lengths[doc] = words.size();
+                    map<string, int> frequency;
+                    for (const string &word : words)
+                        frequency[word]++;
+                    for (auto &term : frequency)
+                        local[t][term.first].push_back({(int)doc, term.second});
+                } });
+        }
+        for (thread &worker : workers)
+            worker.join();
+        workers.clear();
+
+        hash<string> hasher;
+        vector<unordered_map<string, PostingList>> encoded(threads);
+        for (int t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&, t]
+                                 {
+                for (int source = 0; source < threads; source++)
+                {
+                    for (auto &term : local[source])
+                    {
+                        if ((int)(hasher(term.first) % threads) != t)
+                            continue;
+                        PostingList &list = encoded[t][term.first];
+                        for (auto &posting : term.second)
+                            append(list, posting.first, posting.second);
+                    }
+                } });
+        }
+        for (thread &worker : workers)
+            worker.join();
+
+        unique_lock<shared_mutex> guard(lock);
+        postings.clear();
+        for (auto &part : encoded)
+        {
+            for (auto &term : part)
+                postings.emplace(term.first, move(term.second));
+        }
+        docBook.clear();
+        docOfBook.clear();
+        totalLength = 0;
+        for (size_t doc = 0; doc < books.size(); doc++)
+        {
+            docBook.push_back(books[doc].id);
+            docOfBook[books[doc].id] = doc;
+            totalLength += lengths[doc];
+        }
+        docLength = lengths;
+        deleted.assign(books.size(), false);
+        liveDocs = books.size();
+    }
+
+    vector<TextMatch> search(const string &query, int k) const
+    {
+        // Document-at-a-time BM25 with MaxScore pruning: lists whose combined upper bound
+        // cannot beat the current k-th score only score documents found by the others
+        shared_lock<shared_mutex> guard(lock);
+
+        vector<string> terms = tokenize(query);
+        sort(terms.begin(), terms.end());
+        terms.erase(unique(terms.begin(), terms.end()), terms.end());
+
+        vector<Cursor> cursors;
+        for (const string &term : terms)
+        {
+            auto found = postings.find(term);
+            if (found == postings.end())
+                continue;
+            Cursor c;
+            c.list = &found->second;
+            int df = c.list->count;
+            c.idf = log(1.0 + (docBook.size() - df + 0.5) / (df + 0.5));
+            c.upperBound = c.idf * (bm25K1 + 1);
+            next(c);
+            cursors.push_back(c);
+        }
+        if (cursors.empty() || k <= 0)
+            return vector<TextMatch>();
+
+        sort(cursors.begin(), cursors.end(), [](const Cursor &a, const Cursor &b)
+             { return a.upperBound < b.upperBound; });
+        vector<double> boundPrefix(cursors.size() + 1, 0.0); // sum of the bounds of cursors [0, i)
+        for (size_t i = 0; i < cursors.size(); i++)
+            boundPrefix[i + 1] = boundPrefix[i] + cursors[i].upperBound;
+
+        priority_queue<pair<double, int>, vector<pair<double, int>>, greater<pair<double, int>>> top; // min-heap of (score, doc)
+        double threshold = 0.0;
+        size_t firstEssential = 0;
+
+        while (firstEssential < cursors.size())
+        {
+            int doc = INT_MAX;
+            for (size_t i = firstEssential; i < cursors.size(); i++)
+                doc = min(doc, cursors[i].doc);
+            if (doc == INT_MAX)
                 break;
-            default:
-                cout << "Invalid choice. Please try again." << endl;
+
+            double score = 0.0;
+            for (size_t i = firstEssential; i < cursors.size(); i++)
+            {
+                if (cursors[i].doc == doc)
+                {
+                    score += termScore(cursors[i]);
+                    next(cursors[i]);
+                }
+            }
+            for (size_t i = firstEssential; i-- > 0;)
+            {
+                if (score + boundPrefix[i + 1] <= threshold)
+                    break;
+                advanceTo(cursors[i], doc);
+                if (cursors[i].doc == doc)
+                    score += termScore(cursors[i]);
+            }
+
+            if (deleted[doc] || ((int)top.size() == k && score <= threshold))
+                continue;
+            top.push({score, doc});
+            if ((int)top.size() > k)
+                top.pop();
+            if ((int)top.size() == k)
+            {
+                threshold = top.top().first;
+                while (firstEssential < cursors.size() && boundPrefix[firstEssential + 1] <= threshold)
+                    firstEssential++;
+            }
+        }
+
+        vector<TextMatch> matches;
+        while (!top.empty())
+        {
+            matches.push_back({docBook[top.top().second], top.top().first});
+            top.pop();
+        }
+        reverse(matches.begin(), matches.end());
+        return matches;
+    }
+};
+
+// =====================================================
+// Circulation History (append-only columnar event log)
+// =====================================================
+
+enum CirculationEventType : uint8_t
+{
+    EventBorrow,       // A loan started
+    EventReturn,       // A loan ended; value = loan length in days
+    EventRenew,        // A loan was extended
+    EventReserve,      // A hold was placed
+    EventHoldFulfilled // A hold turned into a loan; value = days waited
+};
+
+class CirculationLog
+{
+private:
+    // Events are kept column by column. The newest rows sit uncompressed in the tail;
+    // every eventChunkRows rows, or once the oldest of them is eventSealSeconds old, they
+    // are sealed into an immutable, varint-compressed chunk and appended to the log file.
+    struct Columns
+    {
+        vector<int32_t> day;      // Day number of the event
+        vector<uint8_t> type;     // CirculationEventType
+        vector<int32_t> book;     // Book ID
+        vector<int32_t> student;  // Index into studentNames
+        vector<int32_t> category; // Index into categoryNames
+        vector<int32_t> value;    // Loan length or wait in days, 0 otherwise
+
+        size_t size() const { return day.size(); }
+    };
+
+    struct Chunk
+    {
+        int rows = 0;             // Events in the chunk
+        vector<uint8_t> day;      // Zigzag varint deltas from the previous day
+        vector<uint8_t> type;     // One byte per event
+        vector<uint8_t> book;     // Zigzag varints, as are the columns below
+        vector<uint8_t> student;  // Dictionary indexes
+        vector<uint8_t> category; // Dictionary indexes
+        vector<uint8_t> value;    // Day counts
+    };
+
+    string fileName;                              // Log file, appended one chunk at a time
+    vector<shared_ptr<const Chunk>> chunks;       // Sealed chunks, never modified
+    Columns tail;                                 // Rows not sealed yet
+    chrono::steady_clock::time_point tailStarted; // When the tail's first row arrived
+    vector<string> studentNames;                  // Dictionary of student IDs
+    vector<string> categoryNames;                 // Dictionary of categories
+    unordered_map<string, int> studentRefs;       // Student ID -> dictionary index
+    unordered_map<string, int> categoryRefs;      // Category -> dictionary index
+    size_t studentsWritten = 0;                   // Student IDs already in the file
+    size_t categoriesWritten = 0;                 // Categories already in the file
+    mutable mutex lock;                           // Short critical sections only; scans run outside it
+    mutex fileLock;                               // Orders appends to the file; held without lock while writing
+
+    static void putVarint(vector<uint8_t> &bytes, int32_t signedValue)
+    {
+        uint32_t value = ((uint32_t)signedValue << 1) ^ (uint32_t)(signedValue >> 31); // zigzag
+        while (value >= 0x80)
+        {
+            bytes.push_back((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        bytes.push_back(value);
+    }
+
+    static bool decodeColumn(const vector<uint8_t> &bytes, int rows, vector<int32_t> &out, bool deltas)
+    {
+        // False if the column does not hold exactly rows varints of at most five bytes
+        out.resize(rows);
+        size_t offset = 0;
+        int32_t previous = 0;
+        for (int i = 0; i < rows; i++)
+        {
+            uint32_t value = 0;
+            for (int shift = 0;; shift += 7)
+            {
+                if (offset >= bytes.size() || shift > 28)
+                    return false;
+                uint8_t byte = bytes[offset++];
+                value |= (uint32_t)(byte & 0x7F) << shift;
+                if (!(byte & 0x80))
+                    break;
+            }
+            int32_t decoded = (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+            out[i] = deltas ? (int32_t)((uint32_t)previous + (uint32_t)decoded) : decoded;
+            previous = out[i];
+        }
+        return offset == bytes.size();
+    }
+
+    static int reference(const string &name, vector<string> &names, unordered_map<string, int> &refs)
+    {
+        auto found = refs.find(name);
+        if (found != refs.end())
+            return found->second;
+        names.push_back(name);
+        refs[name] = names.size() - 1;
+        return names.size() - 1;
+    }
+
+    static void writeBytes(ofstream &file, const vector<uint8_t> &bytes)
+    {
+        uint32_t size = bytes.size();
+        file.write((const char *)&size, sizeof(size));
+        file.write((const char *)bytes.data(), size);
+    }
+
+    static bool readBytes(ifstream &file, streamoff fileEnd, vector<uint8_t> &bytes)
+    {
+        // A size running past the end of the file is a torn write or corruption; it is
+        // refused before allocating, so a damaged prefix cannot ask for gigabytes
+        uint32_t size;
+        if (!file.read((char *)&size, sizeof(size)))
+            return false;
+        streamoff position = file.tellg();
+        if (position < 0 || size > fileEnd - position)
+            return false;
+        bytes.resize(size);
+        return (bool)file.read((char *)bytes.data(), size);
+    }
+
+    bool decodes(const Chunk &chunk) const
+    {
+        // Whether a chunk read from the file is whole: every column holds exactly its rows,
+        // event types are known and dictionary references point at names read before it
+        if (chunk.rows < 0 || chunk.type.size() != (size_t)chunk.rows)
+            return false;
+        for (uint8_t type : chunk.type)
+        {
+            if (type > EventHoldFulfilled)
+                return false;
+        }
+        vector<int32_t> column;
+        for (const vector<uint8_t> *bytes : {&chunk.day, &chunk.book, &chunk.value})
+        {
+            if (!decodeColumn(*bytes, chunk.rows, column, bytes == &chunk.day))
+                return false;
+        }
+        auto refersWithin = [&](const vector<uint8_t> &bytes, size_t names)
+        {
+            if (!decodeColumn(bytes, chunk.rows, column, false))
+                return false;
+            return all_of(column.begin(), column.end(), [&](int32_t ref)
+                          { return ref >= 0 && (size_t)ref < names; });
+        };
+        return refersWithin(chunk.student, studentNames.size()) && refersWithin(chunk.category, categoryNames.size());
+    }
+
+    void seal(unique_lock<mutex> &guard)
+    {
+        // Compresses the tail into a chunk and appends it, with any new dictionary entries, to
+        // the file. The chunk is built under the lock; the file is written after releasing it,
+        // under fileLock, taken first so chunks reach the file in the order they were sealed.
+        shared_ptr<Chunk> chunk(new Chunk);
+        chunk->rows = tail.size();
+        int32_t previousDay = 0;
+        for (size_t i = 0; i < tail.size(); i++)
+        {
+            putVarint(chunk->day, tail.day[i] - previousDay);
+            previousDay = tail.day[i];
+            putVarint(chunk->book, tail.book[i]);
+            putVarint(chunk->student, tail.student[i]);
+            putVarint(chunk->category, tail.category[i]);
+            putVarint(chunk->value, tail.value[i]);
+        }
+        chunk->type = tail.type;
+        chunks.push_back(chunk);
+        tail = Columns();
+
+        if (fileName.empty())
+            return;
+        vector<string> newStudents(studentNames.begin() + studentsWritten, studentNames.end());
+        vector<string> newCategories(categoryNames.begin() + categoriesWritten, categoryNames.end());
+        studentsWritten = studentNames.size();
+        categoriesWritten = categoryNames.size();
+        lock_guard<mutex> writing(fileLock);
+        guard.unlock();
+
+        ofstream file(fileName, ios::binary | ios::app);
+        if (!file.is_open())
+            return;
+        for (const string &name : newStudents)
+        {
+            file.put('S');
+            writeBytes(file, vector<uint8_t>(name.begin(), name.end()));
+        }
+        for (const string &name : newCategories)
+        {
+            file.put('G');
+            writeBytes(file, vector<uint8_t>(name.begin(), name.end()));
+        }
+        file.put('C');
+        file.write((const char *)&chunk->rows, sizeof(chunk->rows));
+        for (const vector<uint8_t> *column : {&chunk->day, &chunk->type, &chunk->book, &chunk->student, &chunk->category, &chunk->value})
+            writeBytes(file, *column);
+    }
+
+    template <typename Visitor>
+    void scan(Visitor visit) const
+    {
+        // Hands every batch of rows, column by column, to the visitor; only the tail copy
+        // is taken under the lock, sealed chunks are immutable and decoded outside it
+        vector<shared_ptr<const Chunk>> sealed;
+        Columns recent;
+        {
+            lock_guard<mutex> guard(lock);
+            sealed = chunks;
+            recent = tail;
+        }
+
+        Columns batch;
+        for (const auto &chunk : sealed)
+        {
+            // Chunks were sealed here or checked by decodes() on load, so these hold
+            bool whole = decodeColumn(chunk->day, chunk->rows, batch.day, true) &&
+                         decodeColumn(chunk->book, chunk->rows, batch.book, false) &&
+                         decodeColumn(chunk->student, chunk->rows, batch.student, false) &&
+                         decodeColumn(chunk->category, chunk->rows, batch.category, false) &&
+                         decodeColumn(chunk->value, chunk->rows, batch.value, false);
+            if (!whole)
+                continue;
+            batch.type = chunk->type;
+            visit(batch);
+        }
+        visit(recent);
+    }
+
+public:
+    CirculationLog(string fileName = "") : fileName(fileName)
+    {
+        load();
+    }
+
+    ~CirculationLog()
+    {
+        flush();
+    }
+
+    void load()
+    {
+        // Reads back the chunks sealed by earlier runs. A chunk whose columns do not decode is
+        // dropped and reading goes on with the next record. A record cut short or an unknown
+        // tag ends the log: the file is cut back to the last whole record, so the chunks this
+        // run appends can be read again.
+        if (fileName.empty())
+            return;
+        ifstream file(fileName, ios::binary | ios::ate);
+        if (!file.is_open())
+            return;
+        streamoff fileEnd = file.tellg(), whole = 0;
+        file.seekg(0);
+        char tag;
+        while (file.get(tag))
+        {
+            vector<uint8_t> bytes;
+            if (tag == 'S' || tag == 'G')
+            {
+                if (!readBytes(file, fileEnd, bytes))
+                    break;
+                string name(bytes.begin(), bytes.end());
+                if (tag == 'S')
+                    reference(name, studentNames, studentRefs);
+                else
+                    reference(name, categoryNames, categoryRefs);
+            }
+            else if (tag == 'C')
+            {
+                shared_ptr<Chunk> chunk(new Chunk);
+                if (!file.read((char *)&chunk->rows, sizeof(chunk->rows)))
+                    break;
+                bool complete = true;
+                for (vector<uint8_t> *column : {&chunk->day, &chunk->type, &chunk->book, &chunk->student, &chunk->category, &chunk->value})
+                    complete = complete && readBytes(file, fileEnd, *column);
+                if (!complete)
+                    break; // torn write at the end of the file
+                if (decodes(*chunk))
+                    chunks.push_back(chunk);
+            }
+            else
+            {
+                break;
+            }
+            whole = file.tellg();
+        }
+        file.close();
+        studentsWritten = studentNames.size();
+        categoriesWritten = categoryNames.size();
+
+        if (whole < fileEnd)
+        {
+            error_code ignored;
+            filesystem::resize_file(fileName, whole, ignored);
+        }
+    }
+
+    void flush(int olderThanSeconds = 0)
+    {
+        // Seals the tail if its oldest row is at least this old: on shutdown with 0, and from
+        // the checkpoint thread with eventSealSeconds so an idle log still gets written out
+        unique_lock<mutex> guard(lock);
+        if (tail.size() > 0 && chrono::steady_clock::now() - tailStarted >= chrono::seconds(olderThanSeconds))
+            seal(guard);
+    }
+
+    void append(CirculationEventType type, int day, int bookID, const string &studentID, const string &category, int value = 0)
+    {
+        unique_lock<mutex> guard(lock);
+        auto now = chrono::steady_clock::now();
+        if (tail.size() == 0)
+            tailStarted = now;
+        tail.day.push_back(day);
+        tail.type.push_back(type);
+        tail.book.push_back(bookID);
+        tail.student.push_back(reference(studentID, studentNames, studentRefs));
+        tail.category.push_back(reference(category, categoryNames, categoryRefs));
+        tail.value.push_back(value);
+        if ((int)tail.size() >= eventChunkRows || now - tailStarted >= chrono::seconds(eventSealSeconds))
+            seal(guard);
+    }
+
+    void forEachEvent(function<void(CirculationEventType, int, int, int)> visit) const
+    {
+        // Replays (type, day, book, value) of every event in order
+        scan([&](const Columns &rows)
+             {
+            for (size_t i = 0; i < rows.size(); i++)
+                visit((CirculationEventType)rows.type[i], rows.day[i], rows.book[i], rows.value[i]); });
+    }
+
+    size_t memoryBytes() const
+    {
+        lock_guard<mutex> guard(lock);
+        auto columnBytes = [](const auto &columns)
+        {
+            return heapBytes(columns.day) + heapBytes(columns.type) + heapBytes(columns.book) +
+                   heapBytes(columns.student) + heapBytes(columns.category) + heapBytes(columns.value);
+        };
+        size_t bytes = heapBytes(chunks) + columnBytes(tail) + heapBytes(studentNames) + heapBytes(categoryNames) +
+                       heapBytes(studentRefs) + heapBytes(categoryRefs) + heapBytes(fileName);
+        for (const auto &chunk : chunks)
+            bytes += sizeof(Chunk) + 2 * sizeof(long) + columnBytes(*chunk); // plus the shared_ptr control block
+        for (const string &name : studentNames)
+            bytes += 2 * heapBytes(name); // the reverse map keeps a copy
+        for (const string &name : categoryNames)
+            bytes += 2 * heapBytes(name);
+        return bytes;
+    }
+
+    long long eventCount() const
+    {
+        lock_guard<mutex> guard(lock);
+        long long count = tail.size();
+        for (const auto &chunk : chunks)
+            count += chunk->rows;
+        return count;
+    }
+
+    vector<pair<int, long long>> mostBorrowedBooks(int k) const
+    {
+        // Group by book over borrow events, then keep the k largest counts
+        unordered_map<int, long long> counts;
+        scan([&](const Columns &rows)
+             {
+            for (size_t i = 0; i < rows.size(); i++)
+            {
+                if (rows.type[i] == EventBorrow)
+                    counts[rows.book[i]]++;
+            } });
+
+        vector<pair<int, long long>> ranked(counts.begin(), counts.end());
+        int top = min<int>(k, ranked.size());
+        partial_sort(ranked.begin(), ranked.begin() + top, ranked.end(), [](const pair<int, long long> &a, const pair<int, long long> &b)
+                     { return a.second != b.second ? a.second > b.second : a.first < b.first; });
+        ranked.resize(top);
+        return ranked;
+    }
+
+    double averageLoanDays() const
+    {
+        // Branch-free sum over the value column of return events
+        long long total = 0, count = 0;
+        scan([&](const Columns &rows)
+             {
+            for (size_t i = 0; i < rows.size(); i++)
+            {
+                int isReturn = rows.type[i] == EventReturn;
+                total += isReturn * rows.value[i];
+                count += isReturn;
+            } });
+        return count ? (double)total / count : 0.0;
+    }
+
+    map<string, double> averageWaitByCategory() const
+    {
+        vector<long long> total, count;
+        scan([&](const Columns &rows)
+             {
+            for (size_t i = 0; i < rows.size(); i++)
+            {
+                if (rows.type[i] != EventHoldFulfilled)
+                    continue;
+                if (rows.category[i] >= (int)total.size())
+                {
+                    total.resize(rows.category[i] + 1, 0);
+                    count.resize(rows.category[i] + 1, 0);
+                }
+                total[rows.category[i]] += rows.value[i];
+                count[rows.category[i]]++;
+            } });
+
+        map<string, double> averages;
+        lock_guard<mutex> guard(lock);
+        for (size_t c = 0; c < total.size(); c++)
+        {
+            if (count[c] > 0)
+                averages[categoryNames[c]] = (double)total[c] / count[c];
+        }
+        return averages;
+    }
+
+    map<int, long long> eventsPerDay(CirculationEventType type) const
+    {
+        map<int, long long> perDay;
+        scan([&](const Columns &rows)
+             {
+            for (size_t i = 0; i < rows.size(); i++)
+            {
+                if (rows.type[i] == type)
+                    perDay[rows.day[i]]++;
+            } });
+        return perDay;
+    }
+};
+
+// =====================================================
+// Acquisition Demand Statistics
+// =====================================================
+
+struct DemandEstimate
+{
+    int bookID;          // Book the estimate is for
+    int copies;          // Copies currently owned
+    int queueLength;     // Holds waiting right now
+    double borrowRate;   // Borrows per day from the first borrow up to today
+    double meanLoanDays; // Average loan length
+    double meanWaitDays; // Average days a hold waited before it was filled
+    double waitSaved;    // Expected total waiting days saved by buying one more copy; infinite with no copy owned
+};
+
+class DemandTracker
+{
+private:
+    struct Stats
+    {
+        int copies = 0;          // Copies owned
+        int queueLength = 0;     // Holds waiting in the reservation queue
+        long long borrows = 0;   // Borrows seen
+        int firstBorrowDay = -1; // Day of the first borrow seen
+        long long loanDays = 0;  // Sum of finished loan lengths
+        long long loans = 0;     // Finished loans
+        long long waitDays = 0;  // Sum of hold waits
+        long long waits = 0;     // Filled holds
+        double score = 0.0;      // Current waitSaved, also the key in ranking
+    };
+
+    unordered_map<int, Stats> stats; // Book ID -> live statistics
+    set<pair<double, int>> ranking;  // (waitSaved, book ID), best candidate last
+    int today = -1;                  // Latest day seen; rates are measured up to it
+    int scoredDay = -1;              // Day every score in ranking was last computed for
+
+    static double meanLoan(const Stats &s)
+    {
+        return s.loans ? (double)s.loanDays / s.loans : loanDuration;
+    }
+
+    double rate(const Stats &s) const
+    {
+        // Counts the quiet days since the last borrow too, so a book nobody borrows any more cools off
+        if (s.borrows == 0)
+            return 0.0;
+        return (double)s.borrows / (today - s.firstBorrowDay + 1);
+    }
+
+    static double totalWait(double queue, int copies, double loanDays)
+    {
+        // Holder i in a FIFO queue served by c copies waits about ceil(i / c) loan periods;
+        // summed over the queue that is loanDays * q * (q + c) / (2c). With no copy at all
+        // nobody in the queue is ever served, so the wait is unbounded.
+        if (queue <= 0)
+            return 0.0;
+        if (copies <= 0)
+            return numeric_limits<double>::infinity();
+        return loanDays * queue * (queue + copies) / (2.0 * copies);
+    }
+
+    double waitSavedByOneCopy(const Stats &s) const
+    {
+        // The queue is the holds waiting now plus the demand a loan period brings that the
+        // current copies cannot absorb. A title with no copy and a queue saves an unbounded
+        // wait, so it ranks ahead of every title that has one.
+        double loanDays = meanLoan(s);
+        double excess = max(0.0, rate(s) * loanDays - s.copies);
+        double queue = s.queueLength + excess;
+        return totalWait(queue, s.copies, loanDays) - totalWait(queue, s.copies + 1, loanDays);
+    }
+
+    void rescore(int bookID, Stats &s)
+    {
+        // Only the changed book moves in the ranking
+        ranking.erase({s.score, bookID});
+        s.score = waitSavedByOneCopy(s);
+        ranking.insert({s.score, bookID});
+    }
+
+public:
+    void onEvent(CirculationEventType type, int day, int bookID, int value)
+    {
+        // Holds placed and filled are not counted here: the queue comes from updateQueue
+        today = max(today, day);
+        Stats &s = stats[bookID];
+        switch (type)
+        {
+        case EventBorrow:
+            s.borrows++;
+            if (s.firstBorrowDay < 0)
+                s.firstBorrowDay = day;
+            break;
+        case EventReturn:
+            s.loanDays += value;
+            s.loans++;
+            break;
+        case EventHoldFulfilled:
+            s.waitDays += value;
+            s.waits++;
+            break;
+        default:
+            return;
+        }
+        rescore(bookID, s);
+    }
+
+    void updateQueue(int bookID, int queueLength)
+    {
+        Stats &s = stats[bookID];
+        if (s.queueLength == queueLength)
+            return;
+        s.queueLength = queueLength;
+        rescore(bookID, s);
+    }
+
+    void updateCopies(int bookID, int copies)
+    {
+        Stats &s = stats[bookID];
+        s.copies = copies;
+        rescore(bookID, s);
+    }
+
+    void removeBook(int bookID)
+    {
+        auto found = stats.find(bookID);
+        if (found == stats.end())
+            return;
+        ranking.erase({found->second.score, bookID});
+        stats.erase(found);
+    }
+
+    vector<DemandEstimate> topCandidates(int n, int day)
+    {
+        // Books where one extra copy saves the most waiting, best first. Rates change as
+        // days pass, so the first call on a new day rescores every book.
+        today = max(today, day);
+        if (scoredDay != today)
+        {
+            ranking.clear();
+            for (auto &entry : stats)
+            {
+                entry.second.score = waitSavedByOneCopy(entry.second);
+                ranking.insert({entry.second.score, entry.first});
+            }
+            scoredDay = today;
+        }
+
+        vector<DemandEstimate> result;
+        for (auto it = ranking.rbegin(); it != ranking.rend() && (int)result.size() < n; ++it)
+        {
+            if (it->first <= 0.0)
+                break;
+            const Stats &s = stats[it->second];
+            result.push_back({it->second, s.copies, s.queueLength, rate(s), meanLoan(s),
+                              s.waits ? (double)s.waitDays / s.waits : 0.0, s.score});
+        }
+        return result;
+    }
+
+    size_t memoryBytes() const
+    {
+        return heapBytes(stats) + heapBytes(ranking);
+    }
+};
+
+// =====================================================
+// Query Result Cache
+// =====================================================
+
+struct QueryCacheStats
+{
+    long long hits = 0;          // Lookups answered from the cache
+    long long misses = 0;        // Lookups that had to run the search
+    long long invalidations = 0; // Entries found but outdated by a catalog change
+    long long evictions = 0;     // Entries dropped to stay within queryCacheCapacity
+};
+
+class QueryCache
+{
+private:
+    struct Entry
+    {
+        vector<Book *> results;  // Pointers into the books vector; availability is read live through them
+        uint64_t contentVersion; // Version of the fields the query looks at when it was filled
+        uint64_t layoutVersion;  // Version of the books vector layout when it was filled
+    };
+
+    list<pair<string, Entry>> entries;                                // Most recently used first
+    unordered_map<string, list<pair<string, Entry>>::iterator> index; // Query key -> entry
+    QueryCacheStats stats;                                            // Hit-rate counters
+    mutex lock;                                                       // Searches may run on several threads
+
+public:
+    bool lookup(const string &key, uint64_t contentVersion, uint64_t layoutVersion, vector<Book *> &results)
+    {
+        lock_guard<mutex> guard(lock);
+        auto found = index.find(key);
+        if (found == index.end())
+        {
+            stats.misses++;
+            return false;
+        }
+
+        Entry &entry = found->second->second;
+        if (entry.contentVersion != contentVersion || entry.layoutVersion != layoutVersion)
+        {
+            // A change touched what this query reads: drop the entry instead of serving it
+            stats.invalidations++;
+            stats.misses++;
+            entries.erase(found->second);
+            index.erase(found);
+            return false;
+        }
+
+        stats.hits++;
+        entries.splice(entries.begin(), entries, found->second);
+        results = entry.results;
+        return true;
+    }
+
+    void store(const string &key, uint64_t contentVersion, uint64_t layoutVersion, const vector<Book *> &results)
+    {
+        lock_guard<mutex> guard(lock);
+        auto found = index.find(key);
+        if (found != index.end())
+        {
+            entries.erase(found->second);
+            index.erase(found);
+        }
+
+        entries.push_front({key, {results, contentVersion, layoutVersion}});
+        index[key] = entries.begin();
+        if ((int)entries.size() > queryCacheCapacity)
+        {
+            index.erase(entries.back().first);
+            entries.pop_back();
+            stats.evictions++;
+        }
+    }
+
+    QueryCacheStats getStats()
+    {
+        lock_guard<mutex> guard(lock);
+        return stats;
+    }
+
+    int size()
+    {
+        lock_guard<mutex> guard(lock);
+        return entries.size();
+    }
+
+    size_t memoryBytes()
+    {
+        lock_guard<mutex> guard(lock);
+        size_t bytes = entries.size() * (sizeof(pair<string, Entry>) + 2 * sizeof(void *)) + heapBytes(index);
+        for (const auto &entry : entries)
+            bytes += 2 * heapBytes(entry.first) + heapBytes(entry.second.results); // the index keeps its own key copy
+        return bytes;
+    }
+};
+
+// =====================================================
+// Workload Recording (binary trace of API calls)
+// =====================================================
+
+enum TraceOp : uint8_t
+{
+    TraceSearchTitle,
+    TraceAutocomplete,
+    TraceFuzzy,
+    TraceFullText,
+    TraceCategory,
+    TraceAddBook,
+    TraceUpdateBook,
+    TraceRemoveBook,
+    TraceBorrow,
+    TraceReturn,
+    TraceRenew,
+    TraceReserve,
+    TraceRegister,
+    TraceFine,
+    TraceSort,
+    TraceTransfer,
+    TraceExchange,
+    TraceOpCount
+};
+
+// Argument layout of every operation: 'i' = integer, 's' = string
+const char *const traceFields[TraceOpCount] = {"s", "si", "siii", "si", "s", "issssi", "isss", "i", "is", "iss", "is", "is", "ssssi", "s", "", "iss", "issi"};
+const char *const traceNames[TraceOpCount] = {"search", "autocomplete", "fuzzy", "fulltext", "category", "addBook", "updateBook",
+                                              "removeBook", "borrow", "return", "renew", "reserve", "register", "fine", "sort",
+                                              "transfer", "exchange"};
+
+// Trace file: "LMSTRACE", the traceVersion byte, the wall-clock start as 8 bytes, the library
+// as it was when recording began (a length-prefixed data file), then per call a varint of the microseconds since the previous call, the TraceOp byte and the
+// arguments (zigzag varints for integers, length-prefixed bytes for strings).
+class WorkloadRecorder
+{
+private:
+    ofstream out;                           // Trace file
+    string pending;                         // Encoded calls not written to the file yet
+    chrono::steady_clock::time_point start; // When recording began
+    long long lastMicros = 0;               // Offset of the previous record
+    long long records = 0;                  // Calls recorded
+    mutex lock;                             // Calls may come from several threads
+
+    void putVarint(uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            pending.push_back((char)((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        pending.push_back((char)value);
+    }
+
+    void put(long long value)
+    {
+        putVarint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+    }
+
+    void put(int value)
+    {
+        put((long long)value);
+    }
+
+    void put(const string &text)
+    {
+        putVarint(text.size());
+        pending.append(text);
+    }
+
+    void writePending()
+    {
+        out.write(pending.data(), pending.size());
+        out.flush();
+        pending.clear();
+    }
+
+public:
+    ~WorkloadRecorder()
+    {
+        // Calls still buffered reach the file on a normal exit
+        lock_guard<mutex> guard(lock);
+        if (out.is_open())
+            writePending();
+    }
+
+    bool open(const string &fileName, const string &initialState)
+    {
+        out.open(fileName, ios::binary | ios::trunc);
+        if (!out.is_open())
+            return false;
+        int64_t wallStart = time(0);
+        out.write("LMSTRACE", 8);
+        out.put(traceVersion);
+        out.write((const char *)&wallStart, sizeof(wallStart));
+        put(initialState);
+        writePending();
+        start = chrono::steady_clock::now();
+        return (bool)out;
+    }
+
+    template <typename... Fields>
+    void record(TraceOp op, const Fields &...fields)
+    {
+        lock_guard<mutex> guard(lock);
+        long long micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        putVarint(micros - lastMicros);
+        lastMicros = micros;
+        pending.push_back((char)op);
+        (put(fields), ...);
+        records++;
+        if (pending.size() >= traceBufferBytes)
+            writePending(); // one write per buffer instead of one flush per call
+    }
+
+    long long getRecords()
+    {
+        lock_guard<mutex> guard(lock);
+        return records;
+    }
+};
+
+struct TraceRecord
+{
+    long long micros;       // Time since the start of the recording
+    TraceOp op;             // Operation called
+    vector<long long> ints; // Integer arguments in order
+    vector<string> texts;   // String arguments in order
+};
+
+class WorkloadTrace
+{
+private:
+    ifstream in;          // Trace file
+    long long micros = 0; // Offset of the last record read
+
+    bool getVarint(uint64_t &value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            int byte = in.get();
+            if (byte == EOF)
+                return false;
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+public:
+    int64_t wallStart = 0; // Wall-clock time the recording started
+    string initialState;   // Data file contents when the recording started
+
+    bool open(const string &fileName)
+    {
+        // Traces of another version lay their arguments out differently and are refused
+        in.open(fileName, ios::binary);
+        char magic[9];
+        uint64_t stateSize;
+        if (!in.read(magic, sizeof(magic)) || memcmp(magic, "LMSTRACE", 8) != 0 || magic[8] != traceVersion)
+            return false;
+        if (!in.read((char *)&wallStart, sizeof(wallStart)) || !getVarint(stateSize))
+            return false;
+        initialState.assign(stateSize, '\0');
+        return (bool)in.read(&initialState[0], stateSize);
+    }
+
+    bool next(TraceRecord &record)
+    {
+        uint64_t delta, value;
+        if (!getVarint(delta))
+            return false;
+        int op = in.get();
+        if (op == EOF || op >= TraceOpCount)
+            return false;
+
+        micros += delta;
+        record.micros = micros;
+        record.op = (TraceOp)op;
+        record.ints.clear();
+        record.texts.clear();
+        for (const char *field = traceFields[op]; *field; field++)
+        {
+            if (!getVarint(value))
+                return false;
+            if (*field == 'i')
+            {
+                record.ints.push_back((long long)(value >> 1) ^ -(long long)(value & 1));
+                continue;
+            }
+            string text(value, '\0');
+            if (!in.read(&text[0], value))
+                return false;
+            record.texts.push_back(text);
+        }
+        return true;
+    }
+};
+
+// =====================================================
+// Parallel Reports (work-stealing scans with per-thread accumulators)
+// =====================================================
+
+// Long-lived threads running queued jobs. Reports share one pool; the server has its own.
+class WorkerPool
+{
+private:
+    vector<thread> workers;       // Threads running queued jobs
+    queue<function<void()>> jobs; // Jobs waiting for a worker
+    mutex lock;                   // Guards jobs and stopping
+    condition_variable wake;      // Signals new jobs or shutdown
+    bool stopping = false;        // Set by stop()
+
+public:
+    WorkerPool(int threads = max(1u, thread::hardware_concurrency()))
+    {
+        for (int t = 0; t < threads; t++)
+        {
+            workers.emplace_back([this]
+                                 {
+                while (true)
+                {
+                    function<void()> job;
+                    {
+                        unique_lock<mutex> guard(lock);
+                        wake.wait(guard, [this]
+                                  { return stopping || !jobs.empty(); });
+                        if (jobs.empty())
+                            return;
+                        job = move(jobs.front());
+                        jobs.pop();
+                    }
+                    job();
+                } });
+        }
+    }
+
+    ~WorkerPool()
+    {
+        stop();
+    }
+
+    void stop()
+    {
+        // Runs the jobs already queued, then joins the workers; later calls do nothing
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread &worker : workers)
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+    }
+
+    size_t size() const
+    {
+        return workers.size();
+    }
+
+    void submit(function<void()> job)
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            jobs.push(move(job));
+        }
+        wake.notify_one();
+    }
+};
+
+inline WorkerPool &reportWorkers()
+{
+    // One set of threads for every report in the process, started on first use. Never
+    // destroyed, so a report still running while the process exits keeps its threads.
+    static WorkerPool *workers = new WorkerPool;
+    return *workers;
+}
+
+// Visits indexes [0, n) in chunks of chunkRows, on the calling thread and up to one report
+// worker per core. Each part starts with a contiguous run of chunks, takes them from the
+// front of its own deque and, once that is empty, steals from the back of another part's,
+// so a part that hits expensive records does not hold the report up. Every part folds into
+// its own Accumulator; they are merged once at the end.
+template <typename Accumulator, typename Visit, typename Merge>
+Accumulator parallelReduce(size_t n, Visit visit, Merge merge, size_t chunkRows = reportChunkRows)
+{
+    size_t chunks = (n + chunkRows - 1) / chunkRows;
+    int parts = max<int>(1, min<size_t>(chunks, reportWorkers().size() + 1));
+    if (parts == 1)
+    {
+        Accumulator total{};
+        for (size_t i = 0; i < n; i++)
+            visit(total, i);
+        return total;
+    }
+
+    // Shared with the queued jobs: a job a busy pool starts only after the scan is over
+    // finds its part claimed and returns without touching anything else
+    struct Scan
+    {
+        vector<deque<size_t>> queues; // Chunk numbers owned by each part
+        vector<mutex> queueLocks;     // One per queue
+        vector<Accumulator> local;    // One per part
+        vector<bool> claimed;         // Parts started, or given up by the caller
+        int running = 0;              // Parts running on workers
+        mutex lock;                   // Guards claimed and running
+        condition_variable finished;  // Signals running reaching 0
+
+        Scan(int parts) : queues(parts), queueLocks(parts), local(parts), claimed(parts) {}
+    };
+    auto scan = make_shared<Scan>(parts);
+    for (size_t c = 0; c < chunks; c++)
+        scan->queues[c * parts / chunks].push_back(c);
+
+    auto runPart = [&visit, n, chunkRows, parts](Scan &state, int self)
+    {
+        while (true)
+        {
+            size_t chunk = SIZE_MAX;
+            for (int k = 0; k < parts && chunk == SIZE_MAX; k++)
+            {
+                int victim = (self + k) % parts;
+                lock_guard<mutex> guard(state.queueLocks[victim]);
+                if (state.queues[victim].empty())
+                    continue;
+                chunk = k == 0 ? state.queues[victim].front() : state.queues[victim].back();
+                if (k == 0)
+                    state.queues[victim].pop_front();
+                else
+                    state.queues[victim].pop_back();
+            }
+            if (chunk == SIZE_MAX)
+                return;
+            size_t end = min(n, (chunk + 1) * chunkRows);
+            for (size_t i = chunk * chunkRows; i < end; i++)
+                visit(state.local[self], i);
+        }
+    };
+
+    for (int part = 1; part < parts; part++)
+    {
+        reportWorkers().submit([scan, runPart, part]
+                               {
+            {
+                lock_guard<mutex> guard(scan->lock);
+                if (scan->claimed[part])
+                    return;
+                scan->claimed[part] = true;
+                scan->running++;
+            }
+            runPart(*scan, part);
+            lock_guard<mutex> guard(scan->lock);
+            if (--scan->running == 0)
+                scan->finished.notify_all(); });
+    }
+
+    // The caller steals until every chunk is taken, so parts not started by then have
+    // nothing left to do; it only waits for the ones still running
+    runPart(*scan, 0);
+    {
+        unique_lock<mutex> guard(scan->lock);
+        for (int part = 1; part < parts; part++)
+            scan->claimed[part] = true;
+        scan->finished.wait(guard, [&]
+                            { return scan->running == 0; });
+    }
+
+    for (int part = 1; part < parts; part++)
+        merge(scan->local[0], scan->local[part]);
+    return move(scan->local[0]);
+}
+
+struct PatronReportRow
+{
+    string studentID; // Student ID
+    string name;      // Student name
+    int loans;        // Books currently borrowed
+    int overdue;      // Of those, past their due date
+    int fine;         // Settled fine plus what overdue loans have accrued
+};
+
+struct HoldReportRow
+{
+    int bookID;          // Book ID
+    string title;        // Book title
+    int holds;           // Reservations waiting for the book
+    int availableCopies; // Copies on the shelf
+};
+
+// =====================================================
+// Fine Ledger (per-day accrual, maintained incrementally)
+// =====================================================
+
+class FineLedger
+{
+private:
+    // An overdue loan costs rate * (day - base) from base + 1 until that reaches the cap.
+    // Per student the accruing loans therefore add up to slope * day - intercept, and a
+    // loan only needs attention on the two days its formula changes: when it starts
+    // accruing and when it hits the cap. Those days are kept in boundaries.
+    struct Accrual
+    {
+        string studentID;     // Borrower
+        long long rate;       // Fine per day once accruing
+        long long base;       // Last day that costs nothing: due day + grace days
+        long long cap;        // Most the loan can cost
+        int state = 0;        // 0 = not accruing yet, 1 = accruing, 2 = capped
+        int nextBoundary = 0; // Day of the next state change
+    };
+
+    struct Account
+    {
+        long long slope = 0;     // Sum of rates of accruing loans
+        long long intercept = 0; // Sum of rate * base of accruing loans
+        long long capped = 0;    // Sum of caps of capped loans
+        int openLoans = 0;       // Loans accruing or capped
+        int settled = 0;         // Fines from returned loans (mirrors Student::fine)
+    };
+
+    unordered_map<string, Accrual> loans;    // Loan key -> accrual terms
+    unordered_map<string, Account> accounts; // Student ID -> running totals
+    multimap<int, string> boundaries;        // Day -> loan whose state changes that day
+    set<string> finedPatrons;                // Students owing or accruing anything
+
+    static string keyOf(const string &studentID, int slot)
+    {
+        return studentID + "#" + to_string(slot);
+    }
+
+    void updateMembership(const string &studentID)
+    {
+        Account &account = accounts[studentID];
+        if (account.settled > 0 || account.openLoans > 0)
+            finedPatrons.insert(studentID);
+        else
+            finedPatrons.erase(studentID);
+    }
+
+    void eraseBoundary(const string &key, int day)
+    {
+        auto range = boundaries.equal_range(day);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == key)
+            {
+                boundaries.erase(it);
+                return;
+            }
+        }
+    }
+
+public:
+    void openLoan(const string &studentID, int slot, int dueDay, int finePerDay, int graceDays, int fineCap)
+    {
+        closeLoan(studentID, slot, INT_MIN); // a slot holds one loan at a time
+        if (finePerDay <= 0 || fineCap <= 0 || dueDay < 0)
+            return;
+
+        string key = keyOf(studentID, slot);
+        Accrual &loan = loans[key];
+        loan.studentID = studentID;
+        loan.rate = finePerDay;
+        loan.base = dueDay + graceDays;
+        loan.cap = fineCap;
+        loan.nextBoundary = loan.base + 1;
+        boundaries.insert({loan.nextBoundary, key});
+    }
+
+    int closeLoan(const string &studentID, int slot, int returnDay)
+    {
+        // Removes the loan and returns what it costs if returned on returnDay
+        string key = keyOf(studentID, slot);
+        auto found = loans.find(key);
+        if (found == loans.end())
+            return 0;
+
+        Accrual &loan = found->second;
+        Account &account = accounts[studentID];
+        if (loan.state == 1)
+        {
+            account.slope -= loan.rate;
+            account.intercept -= loan.rate * loan.base;
+        }
+        else if (loan.state == 2)
+        {
+            account.capped -= loan.cap;
+        }
+        if (loan.state != 0)
+            account.openLoans--;
+        if (loan.state != 2)
+            eraseBoundary(key, loan.nextBoundary);
+
+        long long fine = returnDay == INT_MIN ? 0 : closingFine(studentID, slot, returnDay);
+        loans.erase(found);
+        updateMembership(studentID);
+        return fine;
+    }
+
+    int closingFine(const string &studentID, int slot, int returnDay) const
+    {
+        // What closeLoan would charge for returning on returnDay, without closing anything
+        auto found = loans.find(keyOf(studentID, slot));
+        if (found == loans.end())
+            return 0;
+        const Accrual &loan = found->second;
+        return min(loan.cap, max(0LL, loan.rate * (returnDay - loan.base)));
+    }
+
+    void settle(const string &studentID, int settledFine)
+    {
+        accounts[studentID].settled = settledFine;
+        updateMembership(studentID);
+    }
+
+    void tick(int today)
+    {
+        // Daily maintenance: touches only loans whose state changes on or before today
+        while (!boundaries.empty() && boundaries.begin()->first <= today)
+        {
+            string key = boundaries.begin()->second;
+            boundaries.erase(boundaries.begin());
+            Accrual &loan = loans[key];
+            Account &account = accounts[loan.studentID];
+
+            if (loan.state == 0)
+            {
+                loan.state = 1;
+                account.slope += loan.rate;
+                account.intercept += loan.rate * loan.base;
+                account.openLoans++;
+                loan.nextBoundary = loan.base + (loan.cap + loan.rate - 1) / loan.rate;
+                boundaries.insert({loan.nextBoundary, key});
+            }
+            else
+            {
+                loan.state = 2;
+                account.slope -= loan.rate;
+                account.intercept -= loan.rate * loan.base;
+                account.capped += loan.cap;
+            }
+            updateMembership(loan.studentID);
+        }
+    }
+
+    int accrued(const string &studentID, int today) const
+    {
+        // O(1): fines of the student's overdue loans as of today (call tick(today) first)
+        auto found = accounts.find(studentID);
+        if (found == accounts.end())
+            return 0;
+        const Account &account = found->second;
+        return account.slope * today - account.intercept + account.capped;
+    }
+
+    vector<pair<string, int>> patronsOwingMoreThan(int threshold, int today)
+    {
+        // Looks only at students with a fine or an overdue loan, never at the whole roster
+        tick(today);
+        vector<pair<string, int>> result;
+        for (const string &studentID : finedPatrons)
+        {
+            int total = accounts[studentID].settled + accrued(studentID, today);
+            if (total > threshold)
+                result.push_back({studentID, total});
+        }
+        sort(result.begin(), result.end(), [](const pair<string, int> &a, const pair<string, int> &b)
+             { return a.second > b.second; });
+        return result;
+    }
+
+    size_t memoryBytes() const
+    {
+        size_t bytes = heapBytes(loans) + heapBytes(accounts) + heapBytes(boundaries) + heapBytes(finedPatrons);
+        for (const auto &loan : loans)
+            bytes += heapBytes(loan.first) + heapBytes(loan.second.studentID);
+        for (const auto &account : accounts)
+            bytes += heapBytes(account.first);
+        for (const auto &boundary : boundaries)
+            bytes += heapBytes(boundary.second);
+        for (const string &studentID : finedPatrons)
+            bytes += heapBytes(studentID);
+        return bytes;
+    }
+};
+
+// =====================================================
+// Optimistic Transactions (per-record versions, validated at commit)
+// =====================================================
+
+// A multi-step circulation workflow reads records into working copies, remembering the
+// version stamp each had, and changes only the copies. Commit checks that no stamp moved,
+// then writes the copies back and runs the side effects; if one moved, the workflow is
+// staged again from fresh records.
+struct LibraryTransaction
+{
+    unordered_map<int, pair<uint64_t, Book>> books;          // Book ID -> (stamp read, working copy)
+    unordered_map<string, pair<uint64_t, Student>> students; // Student ID -> (stamp read, working copy)
+    unordered_map<int, uint64_t> holds;                      // Book ID -> stamp of its hold queue when read
+    vector<pair<int, string>> fulfilledHolds;                // (book, student) holds to drop at commit
+    vector<function<void()>> effects;                        // Events, ledger and index updates run after commit
+};
+
+struct TransactionStats
+{
+    long long committed = 0; // Workflows that committed
+    long long conflicts = 0; // Commits refused because a record changed after staging; staged again
+    long long refused = 0;   // Workflows their own rules refused, or that conflicted on every attempt
+};
+
+class LibraryManagementSystem
+{
+private:
+    vector<Book> books;            // Container holding all books in the library
+    vector<Reserve> reservedBooks; // Container holding all active reservations
+    vector<Student> students;      // Students
+
+    TitleAutocomplete autocomplete; // Prefix index over titles and authors, weighted by borrows
+    FuzzyIndex fuzzyIndex;          // Typo-tolerant index over titles, authors and descriptions
+    DescriptionIndex textIndex;     // BM25 full-text index over descriptions
+    CirculationLog circulationLog;  // Every borrow, return, renewal and hold ever made
+    DemandTracker demand;           // Live per-book demand, fed by the circulation events
+
+    // Search results are cached per query and checked against these counters on every hit
+    QueryCache queryCache;        // Recent search results
+    uint64_t textVersion = 0;     // Bumped when any title, author or description changes
+    uint64_t categoryVersion = 0; // Bumped when any category changes
+    uint64_t layoutVersion = 0;   // Bumped when books move in memory (add, remove, sort)
+
+    vector<RuntimeLoanPolicy> customPolicies; // Policies of custom patron classes
+    FineLedger fineLedger;                    // Running fines of overdue loans
+
+    // Every change stamps the records it touched with the next value of versionClock, so a
+    // stamp is never reused even if a record is removed and added again
+    uint64_t versionClock = 0;               // Last stamp handed out
+    unordered_map<int, uint64_t> holdStamps; // Book ID -> stamp of the last change to its hold queue
+
+    // Workflows may stage on several threads at once, so their counters are atomic
+    atomic<long long> transactionsCommitted{0}; // TransactionStats::committed
+    atomic<long long> transactionConflicts{0};  // TransactionStats::conflicts
+    atomic<long long> transactionsRefused{0};   // TransactionStats::refused
+
+    // After a load the search indexes build on a background thread; every use of them goes
+    // through ensureIndexes(), which waits for the build only if it is still running
+    thread indexBuilder;             // Builds autocomplete, fuzzy and full-text indexes
+    atomic<bool> indexesReady{true}; // False while indexBuilder owns the indexes
+    mutex indexBuildLock;            // Serializes concurrent searches waiting for the build
+    vector<int> pendingBorrows;      // Borrows to replay into autocomplete once it is built
+
+    // Record/replay
+    unique_ptr<WorkloadRecorder> recorder; // Set while a trace is being recorded
+    time_t virtualClock = 0;               // When non-zero, used instead of the wall clock
+
+    struct TraceScope
+    {
+        // Records a call only if it is the outermost traced call on this thread, so e.g. the
+        // borrowBook that processReservations makes during a return is not replayed twice.
+        // Transactions open an empty scope and record once they take effect, in commit order.
+        inline static thread_local int depth = 0;
+        bool outermost = depth == 0; // No traced call encloses this one
+
+        TraceScope()
+        {
+            depth++;
+        }
+
+        template <typename... Fields>
+        TraceScope(WorkloadRecorder *recorder, TraceOp op, const Fields &...fields) : TraceScope()
+        {
+            record(recorder, op, fields...);
+        }
+
+        ~TraceScope()
+        {
+            depth--;
+        }
+
+        template <typename... Fields>
+        void record(WorkloadRecorder *recorder, TraceOp op, const Fields &...fields)
+        {
+            if (recorder && outermost)
+                recorder->record(op, fields...);
+        }
+    };
+
+    // Background checkpointing: the foreground copies the state (the only pause),
+    // the checkpoint thread serializes the copy while borrow/return keep running.
+    string dataFile;                                   // File checkpoints are written to, "" = none
+    thread checkpointThread;                           // Writes queued snapshots to disk
+    mutex checkpointMutex;                             // Guards the fields below
+    condition_variable checkpointSignal;               // Wakes the checkpoint thread
+    condition_variable checkpointWritten;              // Wakes saveLibraryData after a write
+    unique_ptr<LibrarySnapshot> pendingSnapshot;       // Latest snapshot waiting to be written
+    long long snapshotsQueued = 0;                     // Snapshots handed to the checkpoint thread
+    long long snapshotsFinished = 0;                   // Newest of them written or failed
+    bool lastWriteSucceeded = true;                    // Outcome of that write
+    bool stopCheckpointing = false;                    // Set by the destructor
+    CheckpointStats checkpointStats;                   // Pause and write timings
+    int mutationsSinceCheckpoint = 0;                  // Changes not yet covered by a snapshot
+    chrono::steady_clock::time_point lastCheckpointAt; // When the last snapshot was taken
+
+public:
+    LibraryManagementSystem(string dataFile = "library_data.txt")
+        : circulationLog(eventFileFor(dataFile)), dataFile(dataFile), lastCheckpointAt(chrono::steady_clock::now())
+    {
+        circulationLog.forEachEvent([this](CirculationEventType type, int day, int bookID, int value)
+                                    { demand.onEvent(type, day, bookID, value); });
+        checkpointThread = thread(&LibraryManagementSystem::checkpointLoop, this);
+    }
+
+    ~LibraryManagementSystem()
+    {
+        ensureIndexes();
+        if (mutationsSinceCheckpoint > 0 && !saveLibraryData())
+            cout << "Failed to save library data to " << dataFile << endl;
+        {
+            lock_guard<mutex> lock(checkpointMutex);
+            stopCheckpointing = true;
+        }
+        checkpointSignal.notify_one();
+        checkpointThread.join(); // a snapshot still queued is written before the thread exits
+    }
+
+    LibraryManagementSystem(const LibraryManagementSystem &) = delete;
+    LibraryManagementSystem &operator=(const LibraryManagementSystem &) = delete;
+
+    // =====================================================
+    // Searching & Filtering Operations
+    // =====================================================
+
+    Book *searchBookById(int bookID)
+    {
+        Book *result = nullptr;
+        for (Book &book : books)
+        {
+            if (book.id == bookID)
+            {
+                result = &book;
+                break;
+            }
+        }
+        return result;
+    }
+
+    vector<Book *> searchBooksByTitle(string titleKeyword)
+    {
+        TraceScope trace(recorder.get(), TraceSearchTitle, titleKeyword);
+        vector<Book *> results;
+        if (queryCache.lookup("title:" + titleKeyword, textVersion, layoutVersion, results))
+            return results;
+
+        // In compact builds a title shared by several books is decoded and tested once
+        vector<int8_t> tested;
+        auto matching = [&](const string &title)
+        { return title.find(titleKeyword) != string::npos; };
+        for (Book &book : books)
+        {
+            if (book.title.matches(matching, tested))
+            {
+                results.push_back(&book);
+            }
+        }
+        queryCache.store("title:" + titleKeyword, textVersion, layoutVersion, results);
+        return results;
+    }
+
+    vector<Book *> autocompleteBooks(string prefix, int k = 5)
+    {
+        // Most borrowed books whose title or author has a word starting with the prefix
+        TraceScope trace(recorder.get(), TraceAutocomplete, prefix, k);
+        vector<Book *> results;
+        ensureIndexes();
+        for (int id : autocomplete.complete(prefix, k))
+        {
+            Book *book = searchBookById(id);
+            if (book)
+                results.push_back(book);
+        }
+        return results;
+    }
+
+    vector<Book *> fuzzySearchBooks(string query, int maxDistance = -1, bool withDescriptions = false, int k = fuzzyTopK)
+    {
+        // The k books whose title or author, or description if asked, contains the query with
+        // the fewest typos, closest first
+        TraceScope trace(recorder.get(), TraceFuzzy, query, maxDistance, (int)withDescriptions, k);
+        if (maxDistance < 0)
+            maxDistance = FuzzyIndex::defaultDistance(normalizeText(query).size());
+
+        string key = "fuzzy:" + to_string(maxDistance) + ":" + to_string(withDescriptions) + ":" + to_string(k) + ":" + normalizeText(query);
+        vector<Book *> results;
+        if (queryCache.lookup(key, textVersion, layoutVersion, results))
+            return results;
+
+        ensureIndexes();
+        for (const FuzzyMatch &match : fuzzyIndex.search(query, maxDistance, withDescriptions, k))
+        {
+            Book *book = searchBookById(match.bookID);
+            if (book)
+                results.push_back(book);
+        }
+        queryCache.store(key, textVersion, layoutVersion, results);
+        return results;
+    }
+
+    vector<Book *> searchDescriptions(string query, int k = 10)
+    {
+        // Best k books for the query words by BM25 over their descriptions
+        TraceScope trace(recorder.get(), TraceFullText, query, k);
+        string key = "text:" + to_string(k) + ":" + normalizeText(query);
+        vector<Book *> results;
+        if (queryCache.lookup(key, textVersion, layoutVersion, results))
+            return results;
+
+        ensureIndexes();
+        for (const TextMatch &match : textIndex.search(query, k))
+        {
+            Book *book = searchBookById(match.bookID);
+            if (book)
+                results.push_back(book);
+        }
+        queryCache.store(key, textVersion, layoutVersion, results);
+        return results;
+    }
+
+    vector<Book *> filterBooksByCategory(string category)
+    {
+        TraceScope trace(recorder.get(), TraceCategory, category);
+        vector<Book *> results;
+        if (queryCache.lookup("category:" + category, categoryVersion, layoutVersion, results))
+            return results;
+
+        // In compact builds categories are interned, so matching a book is an ID comparison
+        PackedText<CategoryTexts> wanted;
+        bool known = PackedText<CategoryTexts>::existing(category, wanted);
+        for (Book &book : books)
+        {
+            if (known && book.category == wanted)
+            {
+                results.push_back(&book);
+            }
+        }
+        queryCache.store("category:" + category, categoryVersion, layoutVersion, results);
+        return results;
+    }
+
+    // =====================================================
+    // Book Management Operations
+    // =====================================================
+
+    bool addBook(Book newBook)
+    {
+        TraceScope trace(recorder.get(), TraceAddBook, newBook.id, newBook.title.str(), newBook.author.str(), newBook.category.str(), newBook.description.str(), newBook.totalCopies);
+
+        for (int i = 0; i < books.size(); i++)
+        {
+            if (books[i].id == newBook.id)
+            {
+                return false;
+            }
+        }
+
+        newBook.availableCopies = newBook.totalCopies;
+        newBook.version = ++versionClock;
+        books.push_back(newBook);
+        ensureIndexes();
+        autocomplete.addBook(newBook);
+        fuzzyIndex.addBook(newBook);
+        textIndex.addBook(newBook);
+        demand.updateCopies(newBook.id, newBook.totalCopies);
+        textVersion++;
+        categoryVersion++;
+        layoutVersion++;
+
+        noteMutation();
+        return true;
+    }
+
+    int addBooks(const vector<Book> &newBooks)
+    {
+        // Bulk load: skips duplicate IDs and rebuilds the full-text index on all cores at the end
+        unordered_set<int> ids;
+        for (const Book &book : books)
+            ids.insert(book.id);
+
+        ensureIndexes();
+        int added = 0;
+        for (Book newBook : newBooks)
+        {
+            if (!ids.insert(newBook.id).second)
+                continue;
+            newBook.availableCopies = newBook.totalCopies;
+            newBook.version = ++versionClock;
+            books.push_back(newBook);
+            autocomplete.addBook(newBook);
+            fuzzyIndex.addBook(newBook);
+            demand.updateCopies(newBook.id, newBook.totalCopies);
+            added++;
+        }
+
+        textIndex.rebuild(books);
+        textVersion++;
+        categoryVersion++;
+        layoutVersion++;
+        noteMutation();
+        return added;
+    }
+
+    bool updateBookDetails(int bookID, string newTitle, string newAuthor, string newCategory)
+    {
+        TraceScope trace(recorder.get(), TraceUpdateBook, bookID, newTitle, newAuthor, newCategory);
+
+        for (int i = 0; i < books.size(); i++)
+        {
+            if (books[i].id == bookID)
+            {
+                // Only queries over the fields that actually changed lose their cached results
+                if (books[i].title != newTitle || books[i].author != newAuthor)
+                    textVersion++;
+                if (books[i].category != newCategory)
+                    categoryVersion++;
+
+                books[i].title = newTitle;
+                books[i].author = newAuthor;
+                books[i].category = newCategory;
+                books[i].version = ++versionClock;
+                ensureIndexes();
+                autocomplete.updateBook(books[i]);
+                fuzzyIndex.updateBook(books[i]);
+                noteMutation();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool removeBook(int bookID)
+    {
+        TraceScope trace(recorder.get(), TraceRemoveBook, bookID);
+
+        for (int i = 0; i < books.size(); i++)
+        {
+            if (books[i].id != bookID)
+            {
+                continue;
+            }
+
+            if (books[i].availableCopies != books[i].totalCopies)
+            {
+                return false;
+            }
+
+            for (int j = 0; j < reservedBooks.size(); j++)
+            {
+                if (reservedBooks[j].bookID == bookID)
+                {
+                    return false;
+                }
+            }
+
+            books.erase(books.begin() + i);
+            textVersion++;
+            categoryVersion++;
+            layoutVersion++;
+            ensureIndexes();
+            autocomplete.removeBook(bookID);
+            fuzzyIndex.removeBook(bookID);
+            textIndex.removeBook(bookID);
+            demand.removeBook(bookID);
+            if (textIndex.needsCompaction())
+                textIndex.rebuild(books);
+            noteMutation();
+            return true;
+        }
+
+        return false;
+    }
+
+    bool withdrawCopy(int bookID, Book &withdrawn)
+    {
+        // Takes one available copy out of this library (e.g. to send it to another branch)
+        Book *book = searchBookById(bookID);
+        if (!book || book->availableCopies <= 0)
+            return false;
+
+        book->totalCopies--;
+        book->availableCopies--;
+        book->version = ++versionClock;
+        withdrawn = *book;
+        demand.updateCopies(bookID, book->totalCopies);
+        noteMutation();
+        return true;
+    }
+
+    bool receiveCopy(const Book &copy)
+    {
+        // Adds one copy received from elsewhere; unknown titles are added with a single copy
+        Book *book = searchBookById(copy.id);
+        if (!book)
+        {
+            Book newBook = copy;
+            newBook.totalCopies = 1;
+            return addBook(newBook);
+        }
+
+        book->totalCopies++;
+        book->availableCopies++;
+        book->version = ++versionClock;
+        demand.updateCopies(book->id, book->totalCopies);
+        noteMutation();
+        return true;
+    }
+
+    // =====================================================
+    // Borrowing, Returning & Renewal Operations
+    // =====================================================
+
+    bool borrowBook(int bookID, string studentID)
+    {
+        TraceScope trace(recorder.get(), TraceBorrow, bookID, studentID);
+        Book *book = searchBookById(bookID);
+        Student *student = findStudentById(studentID);
+
+        if (!book || !student)
+            return false;
+
+        if (book->availableCopies <= 0)
+            return false;
+
+        // Enforce the limit of the student's patron class
+        int loanDays = 0;
+        bool withinLimit = withPolicy(*student, [&](auto policy)
+                                      {
+            loanDays = policy.loanDuration;
+            return activeLoans(*student) < policy.maxBorrows; });
+        if (!withinLimit)
+            return false;
+
+        // Find empty loan slot
+        for (int i = 0; i < maxBorrows; i++)
+        {
+            if (student->borrowedBooks[i].bookID == 0)
+            {
+                student->borrowedBooks[i].bookID = bookID;
+                student->borrowedBooks[i].studentID = studentID;
+                student->borrowedBooks[i].returnDate = calculateDueDate(loanDays);
+                student->borrowedBooks[i].borrowDate = getCurrentDate();
+                openLedgerLoan(*student, i);
+
+                book->availableCopies--;
+                book->borrowCount++;
+                book->version = student->version = ++versionClock;
+                recordEvent(EventBorrow, *book, studentID);
+                if (indexesReady)
+                    autocomplete.recordBorrow(bookID);
+                else
+                    pendingBorrows.push_back(bookID);
+                noteMutation();
+                return true;
+            }
+        }
+
+        return false; // borrow limit reached
+    };
+
+    bool returnBook(int bookID, string studentID, string returnDate)
+    {
+        TraceScope trace(recorder.get(), TraceReturn, bookID, studentID, returnDate);
+        Book *book = searchBookById(bookID);
+        Student *student = findStudentById(studentID);
+
+        if (!book || !student)
+            return false;
+
+        for (int i = 0; i < maxBorrows; i++)
+        {
+            if (student->borrowedBooks[i].bookID == bookID)
+            {
+                if (!validReturnDate(student->borrowedBooks[i], returnDate))
+                    return false;
+
+                // Fine calculation: per overdue day after the grace period, up to the class's cap
+                student->fine += fineLedger.closeLoan(studentID, i, dayNumber(returnDate));
+                fineLedger.settle(studentID, student->fine);
+
+                recordEvent(EventReturn, *book, studentID, daysBetween(student->borrowedBooks[i].borrowDate, returnDate));
+
+                // Clear loan record
+                student->borrowedBooks[i].bookID = 0;
+                student->borrowedBooks[i].studentID = "";
+                student->borrowedBooks[i].returnDate = "";
+                student->borrowedBooks[i].borrowDate = "";
+
+                book->availableCopies++;
+                book->version = student->version = ++versionClock;
+                noteMutation();
+
+                processReservations(bookID);
+                return true;
+            }
+        }
+
+        return false; // book not found in student's loans
+    };
+
+    static bool validReturnDate(const Loan &loan, const string &returnDate)
+    {
+        // An unparseable date would close the loan with no fine; one before the borrow date
+        // would log a negative loan length
+        int day = dayNumber(returnDate);
+        return day >= 0 && day >= dayNumber(loan.borrowDate);
+    }
+
+    bool renewBook(int bookID, string studentID)
+    {
+        TraceScope trace(recorder.get(), TraceRenew, bookID, studentID);
+        // Check if another student has reserved this book
+        for (const auto &r : reservedBooks)
+        {
+            if (r.bookID == bookID && r.studentID != studentID)
+                return false;
+        }
+
+        Student *student = findStudentById(studentID);
+        if (!student)
+            return false;
+
+        for (int i = 0; i < maxBorrows; i++)
+        {
+            if (student->borrowedBooks[i].bookID == bookID)
+            {
+                // Whatever the loan has accrued so far is owed; the renewed loan starts clean
+                student->fine += fineLedger.closeLoan(studentID, i, dayNumber(getCurrentDate()));
+                fineLedger.settle(studentID, student->fine);
+
+                int loanDays = withPolicy(*student, [](auto policy)
+                                          { return policy.loanDuration; });
+                student->borrowedBooks[i].returnDate = calculateDueDate(loanDays);
+                student->version = ++versionClock;
+                openLedgerLoan(*student, i);
+                Book *book = searchBookById(bookID);
+                if (book)
+                    recordEvent(EventRenew, *book, studentID);
+                noteMutation();
+                return true;
+            }
+        }
+
+        return false; // book not borrowed by this student
+    };
+
+    // =====================================================
+    // Reservation & Queue-Based Operations
+    // =====================================================
+
+    bool reserveBook(int bookID, string studentID)
+    {
+        TraceScope trace(recorder.get(), TraceReserve, bookID, studentID);
+        // Check if the student exists
+        Student *student = findStudentById(studentID);
+        if (!student)
+        {
+            // Assuming some output or logging, but for now, just return false
+            return false;
+        }
+
+        // Check if the book exists
+        Book *book = searchBookById(bookID);
+        if (!book)
+        {
+            return false;
+        }
+
+        // Reservations are only allowed if all copies are currently borrowed
+        if (book->availableCopies > 0)
+        {
+            // Cannot reserve a book that has available copies
+            return false;
+        }
+
+        // Enforce reservation limit: count current reservations for this student
+        int currentReservations = 0;
+        for (const auto &res : reservedBooks)
+        {
+            if (res.studentID == studentID)
+            {
+                currentReservations++;
+            }
+        }
+        int reserveLimit = withPolicy(*student, [](auto policy)
+                                      { return policy.maxReserve; });
+        if (currentReservations >= reserveLimit)
+        {
+            // Student has reached the maximum number of reservations
+            return false;
+        }
+
+        // Prevent duplicate reservations: check if the student already reserved this book
+        for (const auto &res : reservedBooks)
+        {
+            if (res.bookID == bookID && res.studentID == studentID)
+            {
+                // Already reserved
+                return false;
+            }
+        }
+
+        // Add the reservation to the end of the vector (FIFO queue behavior)
+        Reserve newReserve;
+        newReserve.bookID = bookID;
+        newReserve.studentID = studentID;
+        newReserve.reserveDate = getCurrentDate();
+        reservedBooks.push_back(newReserve);
+        holdStamps[bookID] = ++versionClock;
+        recordEvent(EventReserve, *book, studentID);
+        updateDemandQueue(bookID);
+
+        noteMutation();
+        return true;
+    }
+
+    Reserve *getNextReservation(int bookID)
+    {
+        // Iterate through the reservations in order (FIFO)
+        for (auto it = reservedBooks.begin(); it != reservedBooks.end(); ++it)
+        {
+            if (it->bookID == bookID)
+            {
+
+                return &(*it);
+            }
+        }
+
+        return nullptr;
+    }
+
+    void processReservations(int bookID)
+    {
+        // Offer the copy to the holds in queue order. A patron who cannot take it right now
+        // (at their class's loan limit, say) keeps their place and the next one gets it.
+        Book *book = searchBookById(bookID);
+        if (!book || book->availableCopies <= 0)
+            return;
+
+        for (size_t r = 0; r < reservedBooks.size(); r++)
+        {
+            if (reservedBooks[r].bookID != bookID)
+                continue;
+
+            Reserve fulfilled = reservedBooks[r];
+            if (!borrowBook(bookID, fulfilled.studentID))
+                continue;
+
+            book = searchBookById(bookID);
+            if (book)
+                recordEvent(EventHoldFulfilled, *book, fulfilled.studentID, daysBetween(fulfilled.reserveDate, getCurrentDate()));
+
+            // Remove the fulfilled reservation from the vector
+            reservedBooks.erase(reservedBooks.begin() + r);
+            holdStamps[bookID] = ++versionClock;
+            updateDemandQueue(bookID);
+            noteMutation();
+            return;
+        }
+    }
+
+    // =====================================================
+    // Multi-Step Workflows (optimistic transactions)
+    // =====================================================
+
+    Book *readBook(LibraryTransaction &tx, int bookID)
+    {
+        // Working copy of the book in this transaction, read once
+        auto staged = tx.books.find(bookID);
+        if (staged != tx.books.end())
+            return &staged->second.second;
+        Book *book = searchBookById(bookID);
+        if (!book)
+            return nullptr;
+        return &tx.books.emplace(bookID, make_pair(book->version, *book)).first->second.second;
+    }
+
+    Student *readStudent(LibraryTransaction &tx, const string &studentID)
+    {
+        auto staged = tx.students.find(studentID);
+        if (staged != tx.students.end())
+            return &staged->second.second;
+        Student *student = findStudentById(studentID);
+        if (!student)
+            return nullptr;
+        return &tx.students.emplace(studentID, make_pair(student->version, *student)).first->second.second;
+    }
+
+    vector<Reserve> readHolds(LibraryTransaction &tx, int bookID)
+    {
+        // The book's holds in queue order; the whole queue of the book is one record
+        auto stamp = holdStamps.find(bookID);
+        tx.holds.emplace(bookID, stamp == holdStamps.end() ? 0 : stamp->second);
+        vector<Reserve> holds;
+        for (const Reserve &reserve : reservedBooks)
+        {
+            if (reserve.bookID == bookID)
+                holds.push_back(reserve);
+        }
+        return holds;
+    }
+
+    bool commitTransaction(LibraryTransaction &tx)
+    {
+        // Validate: every record read must still carry the stamp it was read with
+        for (auto &entry : tx.books)
+        {
+            Book *book = searchBookById(entry.first);
+            if (!book || book->version != entry.second.first)
+                return false;
+        }
+        for (auto &entry : tx.students)
+        {
+            Student *student = findStudentById(entry.first);
+            if (!student || student->version != entry.second.first)
+                return false;
+        }
+        for (auto &entry : tx.holds)
+        {
+            auto stamp = holdStamps.find(entry.first);
+            if ((stamp == holdStamps.end() ? 0 : stamp->second) != entry.second)
+                return false;
+        }
+
+        // Write back only the fields staging changes, under one stamp. Records read but left
+        // as they were keep their stamps, so other workflows that read them still commit.
+        uint64_t stamp = ++versionClock;
+        for (auto &entry : tx.books)
+        {
+            Book *book = searchBookById(entry.first);
+            const Book &staged = entry.second.second;
+            if (book->availableCopies == staged.availableCopies && book->borrowCount == staged.borrowCount)
+                continue;
+            book->availableCopies = staged.availableCopies;
+            book->borrowCount = staged.borrowCount;
+            book->version = stamp;
+        }
+        for (auto &entry : tx.students)
+        {
+            Student *student = findStudentById(entry.first);
+            const Student &staged = entry.second.second;
+            bool changed = student->fine != staged.fine;
+            student->fine = staged.fine;
+            for (int i = 0; i < maxBorrows; i++)
+            {
+                const Loan &loan = staged.borrowedBooks[i];
+                Loan &live = student->borrowedBooks[i];
+                if (live.bookID == loan.bookID && live.borrowDate == loan.borrowDate && live.returnDate == loan.returnDate)
+                    continue;
+                live = loan;
+                changed = true;
+            }
+            if (changed)
+                student->version = stamp;
+        }
+        for (const auto &hold : tx.fulfilledHolds)
+        {
+            for (auto it = reservedBooks.begin(); it != reservedBooks.end(); ++it)
+            {
+                if (it->bookID == hold.first && it->studentID == hold.second)
+                {
+                    reservedBooks.erase(it);
+                    break;
+                }
+            }
+            holdStamps[hold.first] = stamp;
+            updateDemandQueue(hold.first);
+        }
+        for (auto &effect : tx.effects)
+            effect();
+        noteMutation();
+        return true;
+    }
+
+    template <typename Workflow>
+    bool runTransaction(Workflow workflow, shared_mutex *lock = nullptr, function<void()> settled = nullptr)
+    {
+        // Stages the workflow and commits it, staging again from fresh records on a conflict.
+        // With a lock, staging shares it with searches and only the commit holds it alone.
+        // settled runs once the outcome is fixed and before the lock is let go: on a commit
+        // under the exclusive lock, on a refusal under the shared one, where no commit can
+        // land meanwhile. A trace written there replays in the order the library changed.
+        // A workflow that runs out of attempts changed nothing and is not reported.
+        for (int attempt = 0; attempt < transactionAttempts; attempt++)
+        {
+            LibraryTransaction tx;
+            {
+                shared_lock<shared_mutex> reading;
+                if (lock)
+                    reading = shared_lock<shared_mutex>(*lock);
+                if (!workflow(tx))
+                {
+                    transactionsRefused++;
+                    if (settled)
+                        settled();
+                    return false; // the workflow itself refused; nothing to retry
+                }
+            }
+            unique_lock<shared_mutex> writing;
+            if (lock)
+                writing = unique_lock<shared_mutex>(*lock);
+            if (commitTransaction(tx))
+            {
+                transactionsCommitted++;
+                if (settled)
+                    settled();
+                return true;
+            }
+            transactionConflicts++;
+        }
+        transactionsRefused++;
+        return false;
+    }
+
+    TransactionStats getTransactionStats()
+    {
+        TransactionStats stats;
+        stats.committed = transactionsCommitted;
+        stats.conflicts = transactionConflicts;
+        stats.refused = transactionsRefused;
+        return stats;
+    }
+
+    int loanSlot(const Student &student, int bookID)
+    {
+        for (int i = 0; i < maxBorrows; i++)
+        {
+            if (student.borrowedBooks[i].bookID == bookID)
+                return i;
+        }
+        return -1;
+    }
+
+    bool stageReturn(LibraryTransaction &tx, Student &student, int slot, const string &returnDate)
+    {
+        // Frees a loan slot on the working copy; the ledger and the log catch up at commit
+        Loan loan = student.borrowedBooks[slot];
+        Book *book = readBook(tx, loan.bookID);
+        if (!book || !validReturnDate(loan, returnDate))
+            return false;
+        student.fine += fineLedger.closingFine(student.id, slot, dayNumber(returnDate));
+        student.borrowedBooks[slot] = Loan{0, "", "", ""};
+        book->availableCopies++;
+
+        string studentID = student.id;
+        tx.effects.push_back([this, loan, slot, studentID, returnDate]
+                             {
+            fineLedger.closeLoan(studentID, slot, dayNumber(returnDate));
+            fineLedger.settle(studentID, findStudentById(studentID)->fine);
+            recordEvent(EventReturn, *searchBookById(loan.bookID), studentID, daysBetween(loan.borrowDate, returnDate)); });
+        return true;
+    }
+
+    bool stageBorrow(LibraryTransaction &tx, Student &student, int slot, int bookID)
+    {
+        // Fills a loan slot on the working copy if a copy is free and the class allows one more
+        Book *book = readBook(tx, bookID);
+        if (!book || book->availableCopies <= 0)
+            return false;
+        int loanDays = 0;
+        bool withinLimit = withPolicy(student, [&](auto policy)
+                                      {
+            loanDays = policy.loanDuration;
+            return activeLoans(student) < policy.maxBorrows; });
+        if (!withinLimit || student.borrowedBooks[slot].bookID != 0)
+            return false;
+
+        student.borrowedBooks[slot] = Loan{bookID, student.id, calculateDueDate(loanDays), getCurrentDate()};
+        book->availableCopies--;
+        book->borrowCount++;
+
+        string studentID = student.id;
+        tx.effects.push_back([this, bookID, slot, studentID]
+                             {
+            openLedgerLoan(*findStudentById(studentID), slot);
+            recordEvent(EventBorrow, *searchBookById(bookID), studentID);
+            if (indexesReady)
+                autocomplete.recordBorrow(bookID);
+            else
+                pendingBorrows.push_back(bookID); });
+        return true;
+    }
+
+    bool stageTransfer(LibraryTransaction &tx, int bookID, const string &fromID, const string &toID)
+    {
+        // The first patron returns the copy today and the second borrows it on their own
+        // class's terms. Refused if the receiver is at their limit or another patron is
+        // ahead of them in the book's hold queue; a receiver first in the queue gets their hold.
+        Student *from = readStudent(tx, fromID);
+        Student *to = readStudent(tx, toID);
+        if (!from || !to || fromID == toID)
+            return false;
+        int fromSlot = loanSlot(*from, bookID), toSlot = loanSlot(*to, 0);
+        if (fromSlot < 0 || toSlot < 0)
+            return false;
+
+        vector<Reserve> holds = readHolds(tx, bookID);
+        if (!holds.empty() && holds[0].studentID != toID)
+            return false;
+
+        if (!stageReturn(tx, *from, fromSlot, getCurrentDate()) || !stageBorrow(tx, *to, toSlot, bookID))
+            return false;
+        if (!holds.empty())
+        {
+            tx.fulfilledHolds.push_back({bookID, toID});
+            Reserve hold = holds[0];
+            tx.effects.push_back([this, hold]
+                                 { recordEvent(EventHoldFulfilled, *searchBookById(hold.bookID), hold.studentID, daysBetween(hold.reserveDate, getCurrentDate())); });
+        }
+        return true;
+    }
+
+    bool stageExchange(LibraryTransaction &tx, int returnID, const string &studentID, const string &returnDate, int borrowID)
+    {
+        // Returns one book and borrows another in its slot, so a patron at their limit can
+        // swap; the returned copy then goes to its hold queue as after a plain return
+        Student *student = readStudent(tx, studentID);
+        if (!student || returnID == borrowID)
+            return false;
+        int slot = loanSlot(*student, returnID);
+        if (slot < 0)
+            return false;
+
+        if (!stageReturn(tx, *student, slot, returnDate) || !stageBorrow(tx, *student, slot, borrowID))
+            return false;
+        tx.effects.push_back([this, returnID]
+                             { processReservations(returnID); });
+        return true;
+    }
+
+    bool transferLoan(int bookID, string fromID, string toID, shared_mutex *lock = nullptr)
+    {
+        // Atomic hand-over of a borrowed copy between two patrons
+        TraceScope trace;
+        return runTransaction([&](LibraryTransaction &tx)
+                              { return stageTransfer(tx, bookID, fromID, toID); },
+                              lock, [&]
+                              { trace.record(recorder.get(), TraceTransfer, bookID, fromID, toID); });
+    }
+
+    bool exchangeBook(int returnID, string studentID, string returnDate, int borrowID, shared_mutex *lock = nullptr)
+    {
+        // Atomic return-then-borrow: either both happen or neither
+        TraceScope trace;
+        return runTransaction([&](LibraryTransaction &tx)
+                              { return stageExchange(tx, returnID, studentID, returnDate, borrowID); },
+                              lock, [&]
+                              { trace.record(recorder.get(), TraceExchange, returnID, studentID, returnDate, borrowID); });
+    }
+
+    // =====================================================
+    // Student Management & Fine Handling
+    // =====================================================
+
+    bool registerStudent(Student newStudent)
+    {
+        TraceScope trace(recorder.get(), TraceRegister, newStudent.id, newStudent.name, newStudent.phoneNumber, newStudent.email, newStudent.patronClass);
+        // Check if the student ID already exists to ensure uniqueness
+        if (findStudentById(newStudent.id) != nullptr)
+        {
+            // ID is not unique, registration fails
+            return false;
+        }
+
+        // The patron class must be built in or registered
+        if (newStudent.patronClass < 0 || newStudent.patronClass >= BuiltInPatronClasses + (int)customPolicies.size())
+        {
+            return false;
+        }
+
+        // Initialize the borrowed books array to ensure no garbage values
+        for (int i = 0; i < maxBorrows; i++)
+        {
+            newStudent.borrowedBooks[i].bookID = 0;
+            newStudent.borrowedBooks[i].studentID = "";
+            newStudent.borrowedBooks[i].returnDate = "";
+            newStudent.borrowedBooks[i].borrowDate = "";
+        }
+
+        // Add the new student to the students vector
+        newStudent.version = ++versionClock;
+        students.push_back(newStudent);
+        noteMutation();
+        return true;
+    }
+
+    int registerPatronClass(RuntimeLoanPolicy policy)
+    {
+        // Adds a custom patron class and returns its number for Student::patronClass
+        policy.maxBorrows = min(policy.maxBorrows, maxBorrows);
+        customPolicies.push_back(policy);
+        return BuiltInPatronClasses + customPolicies.size() - 1;
+    }
+
+    template <typename Action>
+    auto withPolicy(const Student &student, Action action) -> decltype(action(LoanPolicy<Undergraduate>()))
+    {
+        // Calls action with the student's policy: a LoanPolicy<> for the built-in classes, so
+        // the action is compiled once per class with constant limits, or the registered
+        // RuntimeLoanPolicy for custom classes
+        switch (student.patronClass)
+        {
+        case Undergraduate:
+            return action(LoanPolicy<Undergraduate>());
+        case Staff:
+            return action(LoanPolicy<Staff>());
+        case Faculty:
+            return action(LoanPolicy<Faculty>());
+        default:
+            return action(customPolicies[student.patronClass - BuiltInPatronClasses]);
+        }
+    }
+
+    static int activeLoans(const Student &student)
+    {
+        // Branch-free count of occupied loan slots
+        int count = 0;
+        for (int i = 0; i < maxBorrows; i++)
+            count += student.borrowedBooks[i].bookID != 0;
+        return count;
+    }
+
+    Student *findStudentById(string studentID)
+    {
+        // Iterate through the students vector to find the matching ID
+        for (int i = 0; i < students.size(); i++)
+        {
+            if (students[i].id == studentID)
+            {
+                // Found the student, return a pointer to it
+                return &students[i];
+            }
+        }
+        // Student not found, return nullptr
+        return nullptr;
+    }
+
+    int calculateTotalFine(string studentID)
+    {
+        TraceScope trace(recorder.get(), TraceFine, studentID);
+        // Find the student by ID
+        Student *student = findStudentById(studentID);
+        if (!student)
+        {
+            // Student not found, return 0 as no fine can be calculated
+            return 0;
+        }
+
+        // Accumulated fine from past returns plus what the overdue loans have accrued by today
+        int today = dayNumber(getCurrentDate());
+        fineLedger.tick(today);
+        return student->fine + fineLedger.accrued(studentID, today);
+    }
+
+    void openLedgerLoan(Student &student, int slot)
+    {
+        // Registers a loan's due date and its class's fine terms with the ledger
+        const Loan &loan = student.borrowedBooks[slot];
+        withPolicy(student, [&](auto policy)
+                   { fineLedger.openLoan(student.id, slot, dayNumber(loan.returnDate), policy.finePerDay, policy.graceDays, policy.fineCap); });
+    }
+
+    vector<pair<string, int>> getPatronsWithFinesOver(int threshold)
+    {
+        // (student ID, total fine) for everyone owing more than threshold, largest first
+        return fineLedger.patronsOwingMoreThan(threshold, dayNumber(getCurrentDate()));
+    }
+
+    void displayPatronsWithFinesOver(int threshold)
+    {
+        vector<pair<string, int>> patrons = getPatronsWithFinesOver(threshold);
+        if (patrons.empty())
+        {
+            cout << "\nNo patron owes more than $" << threshold << ".\n";
+            return;
+        }
+
+        cout << "\n=========== PATRONS WITH FINES ===========\n";
+        for (const auto &entry : patrons)
+        {
+            Student *student = findStudentById(entry.first);
+            cout << left << setw(12) << entry.first << setw(25) << (student ? student->name : "")
+                 << "$" << entry.second << endl;
+        }
+        cout << "==========================================\n";
+    }
+
+    // =====================================================
+    // Reports, Sorting & Persistence Preparation
+    // =====================================================
+
+    vector<Book> getOverdueBooks()
+    {
+        // One entry per overdue loan: students are scanned in parallel, then the IDs are
+        // resolved through a single book lookup table instead of a search per loan
+        string today = getCurrentDate();
+        vector<int> overdueIDs = parallelReduce<vector<int>>(
+            students.size(),
+            [&](vector<int> &found, size_t s)
+            {
+                const Student &student = students[s];
+                for (int i = 0; i < maxBorrows; i++)
+                {
+                    // Check if the book is overdue
+                    if (student.borrowedBooks[i].bookID != 0 && student.borrowedBooks[i].returnDate < today)
+                        found.push_back(student.borrowedBooks[i].bookID);
+                }
+            },
+            [](vector<int> &into, vector<int> &from)
+            { into.insert(into.end(), from.begin(), from.end()); });
+
+        unordered_map<int, const Book *> byID = booksByID();
+        vector<Book> overdueBooks;
+        for (int bookID : overdueIDs)
+        {
+            auto found = byID.find(bookID);
+            if (found != byID.end())
+                overdueBooks.push_back(*found->second);
+        }
+        return overdueBooks;
+    }
+
+    unordered_map<int, const Book *> booksByID() const
+    {
+        unordered_map<int, const Book *> byID;
+        byID.reserve(books.size());
+        for (const Book &book : books)
+            byID.emplace(book.id, &book);
+        return byID;
+    }
+
+    vector<PatronReportRow> getPatronsWithLoansOrFines()
+    {
+        // End-of-term report: every student holding a book or owing money, in roster order
+        string todayDate = getCurrentDate();
+        int today = dayNumber(todayDate);
+        fineLedger.tick(today); // afterwards accrued() is read-only and safe to share
+        using Rows = vector<pair<size_t, PatronReportRow>>;
+        Rows rows = parallelReduce<Rows>(
+            students.size(),
+            [&](Rows &found, size_t s)
+            {
+                const Student &student = students[s];
+                int loans = 0, overdue = 0;
+                for (int i = 0; i < maxBorrows; i++)
+                {
+                    if (student.borrowedBooks[i].bookID == 0)
+                        continue;
+                    loans++;
+                    overdue += student.borrowedBooks[i].returnDate < todayDate;
+                }
+                int fine = student.fine + fineLedger.accrued(student.id, today);
+                if (loans > 0 || fine > 0)
+                    found.push_back({s, PatronReportRow{student.id, student.name, loans, overdue, fine}});
+            },
+            [](Rows &into, Rows &from)
+            { into.insert(into.end(), make_move_iterator(from.begin()), make_move_iterator(from.end())); });
+
+        sort(rows.begin(), rows.end(), [](const pair<size_t, PatronReportRow> &a, const pair<size_t, PatronReportRow> &b)
+             { return a.first < b.first; });
+        vector<PatronReportRow> report;
+        report.reserve(rows.size());
+        for (auto &row : rows)
+            report.push_back(move(row.second));
+        return report;
+    }
+
+    vector<HoldReportRow> getBooksWithHolds()
+    {
+        // Count the queue per book in parallel, then pick the books with a count, also in parallel
+        using Counts = unordered_map<int, int>;
+        Counts holds = parallelReduce<Counts>(
+            reservedBooks.size(),
+            [&](Counts &counts, size_t r)
+            { counts[reservedBooks[r].bookID]++; },
+            [](Counts &into, Counts &from)
+            {
+                for (auto &entry : from)
+                    into[entry.first] += entry.second;
+            });
+        if (holds.empty())
+            return {};
+
+        using Rows = vector<pair<size_t, HoldReportRow>>;
+        Rows rows = parallelReduce<Rows>(
+            books.size(),
+            [&](Rows &found, size_t b)
+            {
+                auto count = holds.find(books[b].id);
+                if (count != holds.end())
+                    found.push_back({b, HoldReportRow{books[b].id, books[b].title.str(), count->second, books[b].availableCopies}});
+            },
+            [](Rows &into, Rows &from)
+            { into.insert(into.end(), make_move_iterator(from.begin()), make_move_iterator(from.end())); });
+
+        sort(rows.begin(), rows.end(), [](const pair<size_t, HoldReportRow> &a, const pair<size_t, HoldReportRow> &b)
+             { return a.first < b.first; });
+        vector<HoldReportRow> report;
+        report.reserve(rows.size());
+        for (auto &row : rows)
+            report.push_back(move(row.second));
+        return report;
+    }
+
+    void displayPatronsWithLoansOrFines()
+    {
+        vector<PatronReportRow> report = getPatronsWithLoansOrFines();
+        if (report.empty())
+        {
+            cout << "\nNo patron has loans or fines.\n";
+            return;
+        }
+
+        cout << "\n=========== PATRONS WITH LOANS OR FINES ===========\n";
+        cout << left << setw(12) << "ID" << setw(25) << "Name" << setw(8) << "Loans"
+             << setw(10) << "Overdue" << "Fine" << endl;
+        for (const PatronReportRow &row : report)
+        {
+            cout << left << setw(12) << row.studentID << setw(25) << row.name << setw(8) << row.loans
+                 << setw(10) << row.overdue << "$" << row.fine << endl;
+        }
+        cout << "===================================================\n";
+    }
+
+    void displayBooksWithHolds()
+    {
+        vector<HoldReportRow> report = getBooksWithHolds();
+        if (report.empty())
+        {
+            cout << "\nNo book has holds.\n";
+            return;
+        }
+
+        cout << "\n=========== BOOKS WITH HOLDS ===========\n";
+        cout << left << setw(8) << "ID" << setw(35) << "Title" << setw(8) << "Holds" << "Available" << endl;
+        for (const HoldReportRow &row : report)
+        {
+            cout << left << setw(8) << row.bookID << setw(35) << row.title << setw(8) << row.holds
+                 << row.availableCopies << endl;
+        }
+        cout << "========================================\n";
+    }
+
+    void displayOverdueBooks()
+    {
+        vector<Book> overdueBooks = getOverdueBooks();
+
+        if (overdueBooks.empty())
+        {
+            cout << "\nNo overdue books found.\n";
+            return;
+        }
+
+        cout << "\n=========== OVERDUE BOOKS ===========\n";
+
+        for (int i = 0; i < overdueBooks.size(); i++)
+        {
+            cout << "\nBook " << i + 1 << ":\n";
+            cout << "-----------------------------------\n";
+            cout << "ID        : " << overdueBooks[i].id << endl;
+            cout << "Title     : " << overdueBooks[i].title << endl;
+            cout << "Author    : " << overdueBooks[i].author << endl;
+            cout << "Category  : " << overdueBooks[i].category << endl;
+            cout << "Available : " << overdueBooks[i].availableCopies
+                 << " / " << overdueBooks[i].totalCopies << endl;
+        }
+
+        cout << "\n====================================\n";
+    }
+
+    void sortBooksByTitle()
+    {
+        TraceScope trace(recorder.get(), TraceSort);
+        int n = books.size();
+        for (int i = 0; i < n - 1; i++)
+        {
+            for (int j = 0; j < n - i - 1; j++)
+            {
+                if (books[j].title > books[j + 1].title)
+                {
+                    // swaps the book
+                    Book temp = books[j];
+                    books[j] = books[j + 1];
+                    books[j + 1] = temp;
+                }
+            }
+        }
+        layoutVersion++; // cached result pointers now point at other books
+    }
+
+    bool saveLibraryData()
+    {
+        // Synchronous save (used on exit): the snapshot is queued like any checkpoint, so it
+        // cannot race a write already in progress, and this waits until it is on disk
+        long long ticket = checkpointNow();
+        if (ticket == 0)
+            return true; // no data file
+        unique_lock<mutex> lock(checkpointMutex);
+        checkpointWritten.wait(lock, [&]
+                               { return snapshotsFinished >= ticket; });
+        return lastWriteSucceeded;
+    }
+
+    static bool writeSnapshot(const LibrarySnapshot &snapshot, const string &fileName)
+    {
+        // Write to a temporary file first so a crash never leaves a half-written checkpoint
+        string tempName = fileName + ".tmp";
+        ofstream file(tempName);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        writeSnapshot(snapshot, file);
+        file.close();
+        if (file.fail())
+        {
+            return false;
+        }
+
+        // rename() does not replace an existing file on every platform
+        if (rename(tempName.c_str(), fileName.c_str()) != 0)
+        {
+            remove(fileName.c_str());
+            if (rename(tempName.c_str(), fileName.c_str()) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    static void writeSnapshot(const LibrarySnapshot &snapshot, ostream &file)
+    {
+        file << dataFileHeader << "\n";
+        // save custom patron classes (their index is the class number minus BuiltInPatronClasses)
+        file << "PatronClasses:\n";
+        for (const RuntimeLoanPolicy &policy : snapshot.patronClasses)
+        {
+            file << policy.maxBorrows << ","
+                 << policy.maxReserve << ","
+                 << policy.loanDuration << ","
+                 << policy.finePerDay << ","
+                 << policy.graceDays << ","
+                 << policy.fineCap << "\n";
+        }
+        // save books
+        file << "\nBooks:\n";
+        for (const Book &book : snapshot.books)
+        {
+            file << book.id << ","
+                 << escapeField(book.title.str()) << ","
+                 << escapeField(book.author.str()) << ","
+                 << escapeField(book.category.str()) << ","
+                 << book.totalCopies << ","
+                 << book.availableCopies << ","
+                 << book.borrowCount << ","
+                 << escapeField(book.description.str()) << "\n";
+        }
+        // Step 3: Save students
+        file << "\nStudents:\n";
+        for (const Student &student : snapshot.students)
+        {
+            file << escapeField(student.id) << ","
+                 << escapeField(student.name) << ","
+                 << escapeField(student.email) << ","
+                 << escapeField(student.phoneNumber) << ","
+                 << student.fine << ","
+                 << student.patronClass << "\n";
+        }
+        // Save loans: one line per occupied slot
+        file << "\nLoans:\n";
+        for (const Student &student : snapshot.students)
+        {
+            for (int i = 0; i < maxBorrows; i++)
+            {
+                const Loan &loan = student.borrowedBooks[i];
+                if (loan.bookID == 0)
+                    continue;
+                file << escapeField(student.id) << ","
+                     << i << ","
+                     << loan.bookID << ","
+                     << loan.borrowDate << ","
+                     << loan.returnDate << "\n";
+            }
+        }
+        // Step 4: Save reservations
+        file << "\nReservations:\n";
+        for (const Reserve &reserve : snapshot.reservedBooks)
+        {
+            file << reserve.bookID << ","
+                 << escapeField(reserve.studentID) << ","
+                 << reserve.reserveDate << "\n";
+        }
+    }
+
+    static string escapeField(const string &text)
+    {
+        // Commas separate fields and newlines separate records, so both are escaped
+        string escaped;
+        escaped.reserve(text.size());
+        for (char c : text)
+        {
+            if (c == '\\' || c == ',')
+                escaped += '\\';
+            if (c == '\n')
+            {
+                escaped += "\\n";
+                continue;
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    static vector<string> splitFields(const string &line, bool escaped)
+    {
+        // Files written before escaping existed keep any extra commas in the last field
+        vector<string> fields(1);
+        for (size_t i = 0; i < line.size(); i++)
+        {
+            char c = line[i];
+            if (escaped && c == '\\' && i + 1 < line.size())
+            {
+                c = line[++i];
+                fields.back() += c == 'n' ? '\n' : c;
+            }
+            else if (c == ',')
+                fields.emplace_back();
+            else
+                fields.back() += c;
+        }
+        return fields;
+    }
+
+    static bool parseInt(const string &text, int &value)
+    {
+        char *end = nullptr;
+        long parsed = strtol(text.c_str(), &end, 10);
+        if (text.empty() || *end != '\0' || parsed < INT_MIN || parsed > INT_MAX)
+            return false;
+        value = parsed;
+        return true;
+    }
+
+    static bool readSnapshot(const string &fileName, LibrarySnapshot &snapshot)
+    {
+        ifstream file(fileName);
+        return file.is_open() && readSnapshot(file, snapshot);
+    }
+
+    static bool readSnapshot(istream &file, LibrarySnapshot &snapshot)
+    {
+        // Parses a file written by writeSnapshot, or by saves older than the header line.
+        // Any malformed line fails the whole read so a load never installs half a library.
+        string line, section;
+        bool current = getline(file, line) && line == dataFileHeader;
+        if (!current)
+        {
+            file.clear();
+            file.seekg(0);
+        }
+
+        unordered_map<string, int> studentIndex; // Student ID -> position, for the loans
+        while (getline(file, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty())
+                continue;
+            if (line.back() == ':' && line.find(',') == string::npos)
+            {
+                section = line.substr(0, line.size() - 1);
+                continue;
+            }
+
+            if (section == "Books")
+            {
+                // id,title,author,category,total,available,borrowCount,description; saves older
+                // than the header have no borrowCount, and the first ones no description either
+                vector<string> f = splitFields(line, current);
+                size_t textAt = current ? 7 : 6;
+                if (!current && f.size() == textAt)
+                    f.emplace_back();
+                if (f.size() < textAt + 1)
+                    return false;
+                if (!current)
+                {
+                    for (size_t i = textAt + 1; i < f.size(); i++)
+                        f[textAt] += "," + f[i];
+                }
+                else if (f.size() != textAt + 1)
+                    return false;
+
+                Book book;
+                book.title = f[1];
+                book.author = f[2];
+                book.category = f[3];
+                book.description = f[textAt];
+                if (!parseInt(f[0], book.id) || !parseInt(f[4], book.totalCopies) || !parseInt(f[5], book.availableCopies))
+                    return false;
+                if (current && !parseInt(f[6], book.borrowCount))
+                    return false;
+                snapshot.books.push_back(move(book));
+            }
+            else if (section == "Students")
+            {
+                // id,name,email,phone,fine[,patronClass]
+                vector<string> f = splitFields(line, current);
+                if (f.size() != 5 && f.size() != 6)
+                    return false;
+                Student student{}; // value-initialized, so every loan slot starts empty
+                student.id = f[0];
+                student.name = f[1];
+                student.email = f[2];
+                student.phoneNumber = f[3];
+                if (!parseInt(f[4], student.fine) || (f.size() == 6 && !parseInt(f[5], student.patronClass)))
+                    return false;
+                if (student.patronClass < 0 || student.patronClass >= BuiltInPatronClasses + (int)snapshot.patronClasses.size())
+                    return false;
+                studentIndex[student.id] = snapshot.students.size();
+                snapshot.students.push_back(move(student));
+            }
+            else if (section == "Loans")
+            {
+                // studentID,slot,bookID,borrowDate,dueDate
+                vector<string> f = splitFields(line, current);
+                int slot, bookID;
+                if (f.size() != 5 || !parseInt(f[1], slot) || !parseInt(f[2], bookID) || slot < 0 || slot >= maxBorrows)
+                    return false;
+                auto student = studentIndex.find(f[0]);
+                if (student == studentIndex.end())
+                    return false;
+                Loan &loan = snapshot.students[student->second].borrowedBooks[slot];
+                loan.bookID = bookID;
+                loan.studentID = f[0];
+                loan.borrowDate = f[3];
+                loan.returnDate = f[4];
+            }
+            else if (section == "Reservations")
+            {
+                // bookID,studentID[,reserveDate]
+                vector<string> f = splitFields(line, current);
+                Reserve reserve;
+                if ((f.size() != 2 && f.size() != 3) || !parseInt(f[0], reserve.bookID))
+                    return false;
+                reserve.studentID = f[1];
+                reserve.reserveDate = f.size() == 3 ? f[2] : "";
+                snapshot.reservedBooks.push_back(move(reserve));
+            }
+            else if (section == "PatronClasses")
+            {
+                vector<string> f = splitFields(line, current);
+                RuntimeLoanPolicy policy;
+                if (f.size() != 6 || !parseInt(f[0], policy.maxBorrows) || !parseInt(f[1], policy.maxReserve) ||
+                    !parseInt(f[2], policy.loanDuration) || !parseInt(f[3], policy.finePerDay) ||
+                    !parseInt(f[4], policy.graceDays) || !parseInt(f[5], policy.fineCap))
+                    return false;
+                snapshot.patronClasses.push_back(policy);
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return !file.bad();
+    }
+
+    bool loadLibraryData()
+    {
+        // Startup: restores books, students, loans, reservations and custom classes from the
+        // data file
+        LibrarySnapshot snapshot;
+        if (!readSnapshot(dataFile, snapshot))
+            return false;
+        installSnapshot(snapshot);
+        return true;
+    }
+
+    void installSnapshot(LibrarySnapshot &snapshot)
+    {
+        // Replaces the whole library with the snapshot's contents. Installing them is linear;
+        // the search indexes build in the background, so the library takes requests as soon
+        // as this returns.
+        ensureIndexes(); // an earlier build must finish before the indexes are reset
+        books = move(snapshot.books);
+        students = move(snapshot.students);
+        reservedBooks = move(snapshot.reservedBooks);
+        customPolicies = move(snapshot.patronClasses);
+
+        // Fresh stamps: a transaction staged before the load must not validate against it
+        for (Book &book : books)
+            book.version = ++versionClock;
+        holdStamps.clear();
+        for (const Reserve &reserve : reservedBooks)
+            holdStamps[reserve.bookID] = ++versionClock;
+
+        fineLedger = FineLedger();
+        for (Student &student : students)
+        {
+            student.version = ++versionClock;
+            fineLedger.settle(student.id, student.fine);
+            for (int i = 0; i < maxBorrows; i++)
+            {
+                if (student.borrowedBooks[i].bookID != 0)
+                    openLedgerLoan(student, i);
+            }
+        }
+        unordered_map<int, int> waiting;
+        for (const Reserve &reserve : reservedBooks)
+            waiting[reserve.bookID]++;
+        for (const Book &book : books)
+        {
+            demand.updateCopies(book.id, book.totalCopies);
+            demand.updateQueue(book.id, waiting[book.id]);
+        }
+
+        textVersion++;
+        categoryVersion++;
+        layoutVersion++;
+        buildIndexesInBackground();
+    }
+
+    void buildIndexesInBackground()
+    {
+        // The builder works on its own copy of the books, so borrows and returns can change
+        // the live ones meanwhile; autocomplete, fuzzy and full-text build side by side
+        indexesReady = false;
+        autocomplete = TitleAutocomplete();
+        fuzzyIndex = FuzzyIndex();
+        indexBuilder = thread([this, indexed = books]
+                              {
+            thread titles([&]
+                          {
+                for (const Book &book : indexed)
+                    autocomplete.addBook(book); });
+            thread typos([&]
+                         {
+                for (const Book &book : indexed)
+                    fuzzyIndex.addBook(book); });
+            textIndex.rebuild(indexed);
+            titles.join();
+            typos.join(); });
+    }
+
+    void ensureIndexes()
+    {
+        // Waits for a background index build, if any, and hands the indexes back to callers
+        if (indexesReady)
+            return;
+        lock_guard<mutex> guard(indexBuildLock);
+        if (indexesReady)
+            return;
+        indexBuilder.join();
+        for (int bookID : pendingBorrows)
+            autocomplete.recordBorrow(bookID);
+        pendingBorrows.clear();
+        indexesReady = true;
+    }
+
+    // =====================================================
+    // Circulation History & Analytics
+    // =====================================================
+
+    static string eventFileFor(const string &dataFile)
+    {
+        // library_data.txt -> library_data_events.bin; a library without a data file keeps
+        // its events in memory only
+        if (dataFile.empty())
+            return "";
+        string base = dataFile;
+        size_t dot = base.rfind('.');
+        if (dot != string::npos)
+            base = base.substr(0, dot);
+        return base + "_events.bin";
+    }
+
+    static int daysBetween(const string &from, const string &to)
+    {
+        int start = dayNumber(from), end = dayNumber(to);
+        return (start < 0 || end < 0) ? 0 : end - start;
+    }
+
+    void recordEvent(CirculationEventType type, const Book &book, const string &studentID, int value = 0)
+    {
+        int today = dayNumber(getCurrentDate());
+        book.category.read([&](const string &category)
+                           { circulationLog.append(type, today, book.id, studentID, category, value); });
+        demand.onEvent(type, today, book.id, value);
+    }
+
+    void updateDemandQueue(int bookID)
+    {
+        // The demand estimate reads the live hold queue; the event log cannot tell which holds are still open
+        int waiting = 0;
+        for (const Reserve &reserve : reservedBooks)
+            waiting += reserve.bookID == bookID;
+        demand.updateQueue(bookID, waiting);
+    }
+
+    CirculationLog &getCirculationLog()
+    {
+        return circulationLog;
+    }
+
+    void displayCirculationReport()
+    {
+        cout << "\n=========== CIRCULATION HISTORY ===========\n";
+        cout << "Events recorded   : " << circulationLog.eventCount() << endl;
+        cout << fixed << setprecision(1);
+        cout << "Average loan days : " << circulationLog.averageLoanDays() << endl;
+
+        cout << "\nMost borrowed books:\n";
+        for (const auto &entry : circulationLog.mostBorrowedBooks(5))
+        {
+            Book *book = searchBookById(entry.first);
+            cout << "  " << (book ? book->title.str() : "Book " + to_string(entry.first))
+                 << " - " << entry.second << " loans" << endl;
+        }
+
+        cout << "\nAverage reservation wait (days) by category:\n";
+        for (const auto &entry : circulationLog.averageWaitByCategory())
+        {
+            cout << "  " << entry.first << " : " << entry.second << endl;
+        }
+        cout << defaultfloat << setprecision(6);
+        cout << "===========================================\n";
+    }
+
+    vector<DemandEstimate> getAcquisitionCandidates(int n = 10)
+    {
+        return demand.topCandidates(n, dayNumber(getCurrentDate()));
+    }
+
+    void displayAcquisitionReport()
+    {
+        vector<DemandEstimate> candidates = getAcquisitionCandidates();
+        if (candidates.empty())
+        {
+            cout << "\nNo title currently needs extra copies.\n";
+            return;
+        }
+
+        cout << "\n=========== ACQUISITION CANDIDATES ===========\n";
+        cout << fixed << setprecision(1);
+        for (const DemandEstimate &e : candidates)
+        {
+            Book *book = searchBookById(e.bookID);
+            cout << "\n" << (book ? book->title.str() : "Book " + to_string(e.bookID)) << " (ID " << e.bookID << ")\n";
+            cout << "Copies / holds    : " << e.copies << " / " << e.queueLength << endl;
+            cout << "Borrows per day   : " << e.borrowRate << endl;
+            cout << "Avg loan / wait   : " << e.meanLoanDays << " / " << e.meanWaitDays << " days" << endl;
+            if (isinf(e.waitSaved))
+                cout << "Wait saved (days) : unbounded; no copy is owned, so the holds never fill" << endl;
+            else
+                cout << "Wait saved (days) : " << e.waitSaved << " with one more copy" << endl;
+        }
+        cout << defaultfloat << setprecision(6);
+        cout << "\n==============================================\n";
+    }
+
+    QueryCacheStats getQueryCacheStats()
+    {
+        return queryCache.getStats();
+    }
+
+    void displayQueryCacheStats()
+    {
+        QueryCacheStats stats = queryCache.getStats();
+        long long lookups = stats.hits + stats.misses;
+        cout << "\n=========== QUERY CACHE ===========\n";
+        cout << "Entries          : " << queryCache.size() << " / " << queryCacheCapacity << endl;
+        cout << "Hits / misses    : " << stats.hits << " / " << stats.misses << endl;
+        cout << "Hit rate         : " << fixed << setprecision(1)
+             << (lookups ? 100.0 * stats.hits / lookups : 0.0) << "%" << defaultfloat << setprecision(6) << endl;
+        cout << "Invalidated      : " << stats.invalidations << endl;
+        cout << "Evicted          : " << stats.evictions << endl;
+        cout << "====================================\n";
+    }
+
+    // =====================================================
+    // Memory Accounting
+    // =====================================================
+
+    vector<pair<string, size_t>> getMemoryUsage()
+    {
+        // Estimated bytes per subsystem. In compact builds book texts live in the text pools,
+        // which every library in the process shares, so a branch network reports them once
+        // per branch.
+        ensureIndexes();
+        vector<pair<string, size_t>> usage;
+        size_t bookBytes = heapBytes(books);
+        for (const Book &book : books)
+            bookBytes += book.title.memoryBytes() + book.author.memoryBytes() + book.category.memoryBytes() + book.description.memoryBytes();
+        usage.push_back({"books", bookBytes});
+
+        size_t studentBytes = heapBytes(students), loanBytes = 0;
+        for (const Student &student : students)
+        {
+            studentBytes += heapBytes(student.name) + heapBytes(student.id) + heapBytes(student.phoneNumber) + heapBytes(student.email);
+            for (const Loan &loan : student.borrowedBooks)
+                loanBytes += sizeof(Loan) + heapBytes(loan.studentID) + heapBytes(loan.returnDate) + heapBytes(loan.borrowDate);
+        }
+        usage.push_back({"students", studentBytes - students.size() * sizeof(Student::borrowedBooks)});
+        usage.push_back({"loans", loanBytes});
+
+        size_t reserveBytes = heapBytes(reservedBooks) + heapBytes(holdStamps);
+        for (const Reserve &reserve : reservedBooks)
+            reserveBytes += heapBytes(reserve.studentID) + heapBytes(reserve.reserveDate);
+        usage.push_back({"reservations", reserveBytes});
+
+        usage.push_back({"autocomplete index", autocomplete.memoryBytes()});
+        usage.push_back({"fuzzy index", fuzzyIndex.memoryBytes()});
+        usage.push_back({"full-text index", textIndex.memoryBytes()});
+        usage.push_back({"circulation log", circulationLog.memoryBytes()});
+        usage.push_back({"demand statistics", demand.memoryBytes()});
+        usage.push_back({"query cache", queryCache.memoryBytes()});
+        usage.push_back({"fine ledger", fineLedger.memoryBytes()});
+        for (int pool = 0; pool < (compactStrings ? TextPoolCount : 0); pool++)
+            usage.push_back({string("text pool: ") + textPoolNames[pool], textPool(pool).memoryBytes()});
+        return usage;
+    }
+
+    void displayMemoryUsage()
+    {
+        vector<pair<string, size_t>> usage = getMemoryUsage();
+        size_t total = 0;
+        cout << "\n=========== MEMORY USAGE ===========\n";
+        cout << fixed << setprecision(2);
+        for (const auto &part : usage)
+        {
+            cout << left << setw(26) << part.first << right << setw(10) << part.second / 1048576.0 << " MB" << endl;
+            total += part.second;
+        }
+        cout << left << setw(26) << "total (estimated)" << right << setw(10) << total / 1048576.0 << " MB" << endl;
+        if (size_t rss = residentBytes())
+            cout << left << setw(26) << "resident set size" << right << setw(10) << rss / 1048576.0 << " MB" << endl;
+        cout << "String storage            : " << (compactStrings ? "compact (front-coded)" : "plain") << endl;
+        cout << defaultfloat << setprecision(6) << left;
+        cout << "====================================\n";
+    }
+
+    // =====================================================
+    // Background Checkpointing
+    // =====================================================
+
+    unique_ptr<LibrarySnapshot> takeSnapshot()
+    {
+        // Copy the state; this copy is the only time the foreground is paused
+        auto start = chrono::steady_clock::now();
+
+        unique_ptr<LibrarySnapshot> snapshot(new LibrarySnapshot);
+        snapshot->books = books;
+        snapshot->students = students;
+        snapshot->reservedBooks = reservedBooks;
+        snapshot->patronClasses = customPolicies;
+
+        long long pause = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        lock_guard<mutex> lock(checkpointMutex);
+        checkpointStats.lastPauseMicros = pause;
+        checkpointStats.maxPauseMicros = max(checkpointStats.maxPauseMicros, pause);
+        return snapshot;
+    }
+
+    long long checkpointNow()
+    {
+        // Snapshot now and hand it to the checkpoint thread; returns without waiting for the
+        // write. The result numbers the snapshot for saveLibraryData (0 = nothing to write to).
+        mutationsSinceCheckpoint = 0;
+        lastCheckpointAt = chrono::steady_clock::now();
+        if (dataFile.empty())
+            return 0;
+        unique_ptr<LibrarySnapshot> snapshot = takeSnapshot();
+        long long ticket;
+        {
+            lock_guard<mutex> lock(checkpointMutex);
+            pendingSnapshot = move(snapshot); // an older snapshot not yet written is superseded
+            ticket = ++snapshotsQueued;
+        }
+        checkpointSignal.notify_one();
+        return ticket;
+    }
+
+    void noteMutation()
+    {
+        // Called after every successful change; schedules a checkpoint by count or by time
+        mutationsSinceCheckpoint++;
+        bool countDue = mutationsSinceCheckpoint >= checkpointEveryMutations;
+        bool timeDue = chrono::steady_clock::now() - lastCheckpointAt >= chrono::seconds(checkpointEverySeconds);
+        if (countDue || timeDue)
+        {
+            checkpointNow();
+        }
+    }
+
+    void checkpointLoop()
+    {
+        unique_lock<mutex> lock(checkpointMutex);
+        while (true)
+        {
+            // Also wakes every eventSealSeconds to write out circulation events an idle desk left in memory
+            bool woken = checkpointSignal.wait_for(lock, chrono::seconds(eventSealSeconds), [this]
+                                                   { return stopCheckpointing || pendingSnapshot; });
+            if (!woken)
+            {
+                lock.unlock();
+                circulationLog.flush(eventSealSeconds);
+                lock.lock();
+                continue;
+            }
+            if (!pendingSnapshot)
+            {
+                return; // stopping and nothing left to write
+            }
+
+            unique_ptr<LibrarySnapshot> snapshot = move(pendingSnapshot);
+            long long ticket = snapshotsQueued;
+            lock.unlock();
+
+            auto start = chrono::steady_clock::now();
+            bool written = writeSnapshot(*snapshot, dataFile);
+            long long elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+
+            lock.lock();
+            checkpointStats.lastWriteMicros = elapsed;
+            if (written)
+                checkpointStats.checkpointsWritten++;
+            else
+                checkpointStats.checkpointFailures++;
+            snapshotsFinished = ticket;
+            lastWriteSucceeded = written;
+            checkpointWritten.notify_all();
+        }
+    }
+
+    CheckpointStats getCheckpointStats()
+    {
+        lock_guard<mutex> lock(checkpointMutex);
+        return checkpointStats;
+    }
+
+    void displayCheckpointStats()
+    {
+        CheckpointStats stats = getCheckpointStats();
+        cout << "\n=========== CHECKPOINTS ===========\n";
+        cout << "Written          : " << stats.checkpointsWritten << endl;
+        cout << "Failed           : " << stats.checkpointFailures << endl;
+        cout << "Last pause (us)  : " << stats.lastPauseMicros << endl;
+        cout << "Max pause (us)   : " << stats.maxPauseMicros << endl;
+        cout << "Last write (us)  : " << stats.lastWriteMicros << endl;
+        cout << "Pending changes  : " << mutationsSinceCheckpoint << endl;
+        cout << "====================================\n";
+    }
+
+    void setVirtualClock(time_t now)
+    {
+        // Replay drives dates from the trace instead of the wall clock; 0 goes back to the wall clock
+        virtualClock = now;
+    }
+
+    time_t currentTime()
+    {
+        return virtualClock ? virtualClock : time(0);
+    }
+
+    bool startRecording(const string &traceFile)
+    {
+        // The trace opens with the current library so a replay starts from the same state
+        ostringstream state;
+        writeSnapshot(*takeSnapshot(), state);
+        unique_ptr<WorkloadRecorder> newRecorder(new WorkloadRecorder);
+        if (!newRecorder->open(traceFile, state.str()))
+            return false;
+        recorder = move(newRecorder);
+        return true;
+    }
+
+    string calculateDueDate(int daysToAdd)
+    {
+        // Calendar arithmetic rather than mktime(), which rereads the time zone on every call
+        // and is not safe on the worker threads that stage workflows
+        return dateOfDay(dayNumber(getCurrentDate()) + daysToAdd);
+    }
+
+    string getCurrentDate()
+    {
+        tm now = localTime(currentTime());
+        char buffer[11];
+        strftime(buffer, sizeof(buffer), "%Y-%m-%d", &now);
+        return string(buffer);
+    }
+
+    void displayBorrowedBooks(string studentID)
+    {
+        Student *student = findStudentById(studentID);
+
+        if (student == nullptr)
+        {
+            cout << "Student not found.\n";
+            return;
+        }
+
+        bool hasBorrowed = false;
+
+        cout << "\nBorrowed Books for Student ID: " << studentID << endl;
+
+        for (int i = 0; i < maxBorrows; i++)
+        {
+            if (student->borrowedBooks[i].bookID != 0)
+            {
+                hasBorrowed = true;
+                cout << "Book ID: " << student->borrowedBooks[i].bookID
+                     << " | Return Date: " << student->borrowedBooks[i].returnDate
+                     << endl;
+            }
+        }
+
+        if (!hasBorrowed)
+        {
+            cout << "No books currently borrowed.\n";
+        }
+    }
+
+    // =====================================================
+    // Menu System & Quality-of-Life Utilities
+    // =====================================================
+
+    void displayMainMenu()
+    {
+        int choice;
+
+        cout << "\nWelcome to the Library Management System" << endl;
+        cout << "Please select your role:" << endl;
+        cout << "1. Admin" << endl;
+        cout << "2. Student" << endl;
+        cout << "0. Exit" << endl;
+        cout << "Enter your choice: ";
+
+        cin >> choice;
+        cin.ignore();
+
+        handleUserChoice(choice);
+    }
+
+    void handleUserChoice(int choice)
+    {
+        if (choice == 0)
+        {
+            cout << "Exiting the system. Goodbye!" << endl;
+            return;
+        }
+        else if (choice == 1)
+        {
+            // Admin role
+            handleAdminMenu();
+        }
+        else if (choice == 2)
+        {
+            // Student role
+            handleStudentMenu();
+        }
+        else
+        {
+            cout << "Invalid choice. Please try again." << endl;
+        }
+    }
+    // Handles user menu selection and calls the corresponding system operation.
+
+    // Helper function for Admin menu (not part of public interface)
+    void handleAdminMenu()
+    {
+        int adminChoice;
+        do
+        {
+            cout << "\nAdmin Menu:" << endl;
+            cout << "1. Add Book" << endl;
+            cout << "2. Update Book Details" << endl;
+            cout << "3. Remove Book" << endl;
+            cout << "4. Register Student" << endl;
+            cout << "5. Display All Books" << endl;
+            cout << "6. Sort Books by Title" << endl;
+            cout << "7. Save Library Data" << endl;
+            cout << "8. Show all overdue books" << endl;
+            cout << "9. Show Checkpoint Statistics" << endl;
+            cout << "10. Circulation History Report" << endl;
+            cout << "11. Acquisition Report" << endl;
+            cout << "12. Query Cache Statistics" << endl;
+            cout << "13. Patrons With Fines Over an Amount" << endl;
+            cout << "14. Patrons With Loans or Fines" << endl;
+            cout << "15. Books With Holds" << endl;
+            cout << "16. Memory Usage" << endl;
+            cout << "0. Back to Main Menu" << endl;
+            cout << "Enter your choice: ";
+            cin >> adminChoice;
+            cin.ignore(); // Clear input buffer
+
+            switch (adminChoice)
+            {
+            case 1:
+            {
+                Book newBook;
+                string title, author, category, description;
+                cout << "Enter Book ID: ";
+                cin >> newBook.id;
+                cin.ignore();
+                cout << "Enter Title: ";
+                getline(cin, title);
+                cout << "Enter Author: ";
+                getline(cin, author);
+                cout << "Enter Category: ";
+                getline(cin, category);
+                cout << "Enter Description: ";
+                getline(cin, description);
+                newBook.title = title;
+                newBook.author = author;
+                newBook.category = category;
+                newBook.description = description;
+                cout << "Enter Total Copies: ";
+                cin >> newBook.totalCopies;
+                newBook.availableCopies = newBook.totalCopies;
+                if (addBook(newBook))
+                {
+                    cout << "Book added successfully." << endl;
+                }
+                else
+                {
+                    cout << "Failed to add book." << endl;
+                }
+                break;
+            }
+            case 2:
+            {
+                int bookID;
+                string newTitle, newAuthor, newCategory;
+                cout << "Enter Book ID to update: ";
+                cin >> bookID;
+                cin.ignore();
+                cout << "Enter New Title: ";
+                getline(cin, newTitle);
+                cout << "Enter New Author: ";
+                getline(cin, newAuthor);
+                cout << "Enter New Category: ";
+                getline(cin, newCategory);
+                if (updateBookDetails(bookID, newTitle, newAuthor, newCategory))
+                {
+                    cout << "Book updated successfully." << endl;
+                }
+                else
+                {
+                    cout << "Failed to update book. Book with ID not found!" << endl;
+                }
+                break;
+            }
+            case 3:
+            {
+                int bookID;
+                cout << "Enter Book ID to remove: ";
+                cin >> bookID;
+                if (removeBook(bookID))
+                {
+                    cout << "Book removed successfully." << endl;
+                }
+                else
+                {
+                    cout << "Failed to remove book." << endl;
+                }
+                break;
+            }
+            case 4:
+            {
+                Student newStudent;
+                cout << "Enter Student ID: ";
+                getline(cin, newStudent.id);
+                cout << "Enter Name: ";
+                getline(cin, newStudent.name);
+                cout << "Enter Phone Number: ";
+                getline(cin, newStudent.phoneNumber);
+                cout << "Enter Email: ";
+                getline(cin, newStudent.email);
+                cout << "Enter Patron Class (0 = Undergraduate, 1 = Staff, 2 = Faculty): ";
+                cin >> newStudent.patronClass;
+                if (registerStudent(newStudent))
+                {
+                    cout << "Student registered successfully." << endl;
+                }
+                else
+                {
+                    cout << "Failed to register student." << endl;
+                }
+                break;
+            }
+            case 5:
+            {
+                displayAllBooks();
+                break;
+            }
+            case 6:
+            {
+                sortBooksByTitle();
+                cout << "Books sorted by title." << endl;
+                break;
+            }
+            case 7:
+            {
+                checkpointNow();
+                cout << "Library data checkpoint scheduled." << endl;
+                break;
+            }
+            case 8:
+                displayOverdueBooks();
+                break;
+            case 9:
+                displayCheckpointStats();
+                break;
+            case 10:
+                displayCirculationReport();
+                break;
+            case 11:
+                displayAcquisitionReport();
+                break;
+            case 12:
+                displayQueryCacheStats();
+                break;
+            case 13:
+            {
+                int threshold;
+                cout << "Show patrons owing more than: $";
+                cin >> threshold;
+                displayPatronsWithFinesOver(threshold);
+                break;
+            }
+            case 14:
+                displayPatronsWithLoansOrFines();
+                break;
+            case 15:
+                displayBooksWithHolds();
+                break;
+            case 16:
+                displayMemoryUsage();
+                break;
+            case 0:
+                displayMainMenu();
+                break;
+            default:
+                cout << "Invalid choice. Please try again." << endl;
+            }
+        } while (adminChoice != 0);
+    }
+
+    // Helper function for Student menu (not part of public interface)
+    void handleStudentMenu()
+    {
+        string studentID;
+        cout << "Enter your Student ID: ";
+        getline(cin, studentID);
+        Student *student = findStudentById(studentID);
+        if (!student)
+        {
+            cout << "Student ID not found. Returning to main menu." << endl;
+            displayMainMenu();
+            return;
+        }
+
+        int studentChoice;
+        do
+        {
+            cout << "\nStudent Menu (ID: " << studentID << "):" << endl;
+            cout << "1. Search Books by Title" << endl;
+            cout << "2. Filter Books by Category" << endl;
+            cout << "3. Borrow Book" << endl;
+            cout << "4. Return Book" << endl;
+            cout << "5. Renew Book" << endl;
+            cout << "6. Reserve Book" << endl;
+            cout << "7. View Fine" << endl;
+            cout << "8. Display All Books" << endl;
+            cout << "9. Display Borrowed Books" << endl;
+            cout << "10. Autocomplete Title/Author" << endl;
+            cout << "11. Search Descriptions" << endl;
+            cout << "0. Back to Main Menu" << endl;
+            cout << "Enter your choice: ";
+            cin >> studentChoice;
+            cin.ignore(); // Clear input buffer
+
+            switch (studentChoice)
+            {
+            case 1:
+            {
+                string titleKeyword;
+                cout << "Enter title keyword: ";
+                getline(cin, titleKeyword);
+                vector<Book *> results = searchBooksByTitle(titleKeyword);
+                if (results.empty())
+                {
+                    // Nothing matched exactly; fall back to typo-tolerant search
+                    results = fuzzySearchBooks(titleKeyword);
+                    if (!results.empty())
+                        cout << "No exact match. Did you mean:" << endl;
+                }
+                if (results.empty())
+                {
+                    cout << "No books found." << endl;
+                }
+                else
+                {
+                    cout << "Found books:" << endl;
+                    for (auto *b : results)
+                    {
+                        cout << "ID: " << b->id << ", Title: " << b->title << ", Author: " << b->author << endl;
+                    }
+                }
+                break;
+            }
+            case 2:
+            {
+                string category;
+                cout << "Enter category: ";
+                getline(cin, category);
+                vector<Book *> results = filterBooksByCategory(category);
+                if (results.empty())
+                {
+                    cout << "No books found in this category." << endl;
+                }
+                else
+                {
+                    cout << "Books in category " << category << ":" << endl;
+                    for (auto *b : results)
+                    {
+                        cout << "ID: " << b->id << ", Title: " << b->title << ", Author: " << b->author << endl;
+                    }
+                }
+                break;
+            }
+            case 3:
+            {
+                int bookID;
+                cout << "Enter Book ID to borrow: ";
+                cin >> bookID;
+                if (borrowBook(bookID, studentID))
+                {
+                    cout << "Book borrowed successfully." << endl;
+                }
+                else
+                {
+                    cout << "Failed to borrow book." << endl;
+                }
+                break;
+            }
+            case 4:
+            {
+                int bookID;
+                string returnDate;
+                cout << "Enter Book ID to return: ";
+                cin >> bookID;
+                cin.ignore();
+                cout << "Enter Return Date (YYYY-MM-DD): ";
+                getline(cin, returnDate);
+                if (returnBook(bookID, studentID, returnDate))
+                {
+                    cout << "Book returned successfully." << endl;
+                }
+                else
+                {
+                    cout << "Failed to return book." << endl;
+                }
+                break;
+            }
+            case 5:
+            {
+                int bookID;
+                cout << "Enter Book ID to renew: ";
+                cin >> bookID;
+                if (renewBook(bookID, studentID))
+                {
+                    cout << "Book renewed successfully." << endl;
+                }
+                else
+                {
+                    cout << "Failed to renew book." << endl;
+                }
+                break;
+            }
+            case 6:
+            {
+                int bookID;
+                cout << "Enter Book ID to reserve: ";
+                cin >> bookID;
+                if (reserveBook(bookID, studentID))
+                {
+                    cout << "Book reserved successfully." << endl;
+                }
+                else
+                {
+                    cout << "Failed to reserve book." << endl;
+                }
+                break;
+            }
+            case 7:
+            {
+                int fine = calculateTotalFine(studentID);
+                cout << "Total fine: $" << fine << endl;
+                break;
+            }
+            case 8:
+            {
+                displayAllBooks();
+                break;
+            }
+            case 9:
+                displayBorrowedBooks(studentID);
+                break;
+            case 10:
+            {
+                string prefix;
+                cout << "Start typing a title or author: ";
+                getline(cin, prefix);
+                vector<Book *> results = autocompleteBooks(prefix);
+                if (results.empty())
+                {
+                    cout << "No suggestions." << endl;
+                }
+                else
+                {
+                    cout << "Suggestions:" << endl;
+                    for (auto *b : results)
+                    {
+                        cout << "ID: " << b->id << ", Title: " << b->title << ", Author: " << b->author << endl;
+                    }
+                }
+                break;
+            }
+            case 11:
+            {
+                string query;
+                cout << "Enter words to look for: ";
+                getline(cin, query);
+                vector<Book *> results = searchDescriptions(query);
+                if (results.empty())
+                {
+                    cout << "No books found." << endl;
+                }
+                else
+                {
+                    cout << "Best matches:" << endl;
+                    for (auto *b : results)
+                    {
+                        cout << "ID: " << b->id << ", Title: " << b->title << ", Description: " << b->description << endl;
+                    }
+                }
+                break;
+            }
+            case 0:
+                displayMainMenu();
+                break;
+            default:
+                cout << "Invalid choice. Please try again." << endl;
+            }
+        } while (studentChoice != 0);
+    }
+
+    vector<Book> getAllBooks()
+    {
+        return books;
+    }
+    // Returns a list of all books in the library.
+    // Used for browsing, reporting, and UI display.
+
+    vector<Reserve> getReservations()
+    {
+        return reservedBooks;
+    }
+    // Returns the reservation queue in FIFO order.
+
+    void displayAllBooks()
+    {
+        if (books.empty())
+        {
+            cout << "No books in the library." << endl;
+            return;
+        }
+        cout << "All Books in the Library:" << endl;
+        cout << left << setw(10) << "ID" << setw(30) << "Title" << setw(20) << "Author"
+             << setw(15) << "Category" << setw(10) << "Available" << setw(10) << "Total" << endl;
+        cout << string(95, '-') << endl;
+        for (const auto &book : books)
+        {
+            cout << left << setw(10) << book.id << setw(30) << book.title << setw(20) << book.author
+                 << setw(15) << book.category << setw(10) << book.availableCopies << setw(10) << book.totalCopies << endl;
+        }
+    }
+    // Displays all books with formatted details for better readability.
+};
+
+// =====================================================
+// Multi-Branch Network (one shard per branch)
+// =====================================================
+
+struct BranchAvailability
+{
+    int branch;          // Index of the branch holding the book
+    int availableCopies; // Copies currently available there
+};
+
+class LibraryNetwork
+{
+private:
+    struct Branch
+    {
+        string name;                                 // Branch name
+        unique_ptr<LibraryManagementSystem> library; // The branch's own books, students and reservations
+        mutex lock;                                  // Lock domain of this branch only
+    };
+
+    vector<unique_ptr<Branch>> branches; // One shard per branch
+
+public:
+    int addBranch(string name)
+    {
+        // Restores the branch from its own data file if it has one; -1 if that file is unreadable
+        string dataFile = "library_data_" + name + ".txt";
+        unique_ptr<Branch> branch(new Branch);
+        branch->name = name;
+        branch->library.reset(new LibraryManagementSystem(dataFile));
+        if (!branch->library->loadLibraryData() && ifstream(dataFile).good())
+            return -1;
+        branches.push_back(move(branch));
+        return branches.size() - 1;
+    }
+
+    int branchCount()
+    {
+        return branches.size();
+    }
+
+    string branchName(int branch)
+    {
+        return branches[branch]->name;
+    }
+
+    template <typename Operation>
+    auto withBranch(int branch, Operation operation) -> decltype(operation(declval<LibraryManagementSystem &>()))
+    {
+        // Runs an operation on one branch while holding only that branch's lock
+        lock_guard<mutex> lock(branches[branch]->lock);
+        return operation(*branches[branch]->library);
+    }
+
+    vector<BranchAvailability> findAvailableCopies(int bookID)
+    {
+        // "Any copy anywhere": asks every branch, locking each only while it is asked. Each
+        // branch is its own chunk, so the report workers ask branches side by side and one
+        // that is busy does not hold up the others.
+        using Found = vector<BranchAvailability>;
+        Found results = parallelReduce<Found>(
+            branches.size(),
+            [&](Found &found, size_t b)
+            {
+                lock_guard<mutex> lock(branches[b]->lock);
+                Book *book = branches[b]->library->searchBookById(bookID);
+                if (book && book->availableCopies > 0)
+                    found.push_back({(int)b, book->availableCopies});
+            },
+            [](Found &into, Found &from)
+            { into.insert(into.end(), from.begin(), from.end()); },
+            1);
+
+        sort(results.begin(), results.end(), [](const BranchAvailability &a, const BranchAvailability &b)
+             { return a.branch < b.branch; });
+        return results;
+    }
+
+    bool transferCopy(int bookID, int fromBranch, int toBranch)
+    {
+        if (fromBranch == toBranch)
+            return false;
+
+        // Lock both branches together so concurrent transfers cannot deadlock
+        Branch &from = *branches[fromBranch];
+        Branch &to = *branches[toBranch];
+        scoped_lock lock(from.lock, to.lock);
+
+        Book copy;
+        if (!from.library->withdrawCopy(bookID, copy))
+            return false;
+
+        if (!to.library->receiveCopy(copy))
+        {
+            from.library->receiveCopy(copy); // give the copy back rather than lose it
+            return false;
+        }
+        to.library->processReservations(bookID); // hand it to the next reserver there
+        return true;
+    }
+
+    bool fulfilReservationFromNetwork(int bookID, int branch)
+    {
+        // Moves a copy from the branch with the most available copies to satisfy a local hold
+        bool hasHold = withBranch(branch, [&](LibraryManagementSystem &library)
+                                  { return library.getNextReservation(bookID) != nullptr; });
+        if (!hasHold)
+            return false;
+
+        vector<BranchAvailability> sources = findAvailableCopies(bookID);
+        sort(sources.begin(), sources.end(), [](const BranchAvailability &a, const BranchAvailability &b)
+             { return a.availableCopies > b.availableCopies; });
+
+        for (const BranchAvailability &source : sources)
+        {
+            // Availability may have changed since the query; try the next source if so
+            if (source.branch != branch && transferCopy(bookID, source.branch, branch))
+                return true;
+        }
+        return false;
+    }
+
+    int fulfilPendingReservations(int branch)
+    {
+        // Tries to satisfy every distinct book on hold at this branch from the other branches
+        vector<Reserve> queue = withBranch(branch, [](LibraryManagementSystem &library)
+                                           { return library.getReservations(); });
+        set<int> bookIDs;
+        for (const Reserve &r : queue)
+            bookIDs.insert(r.bookID);
+
+        int transferred = 0;
+        for (int bookID : bookIDs)
+        {
+            if (fulfilReservationFromNetwork(bookID, branch))
+                transferred++;
+        }
+        return transferred;
+    }
+
+    // =====================================================
+    // Network Menu
+    // =====================================================
+
+    int askBranch(const string &prompt)
+    {
+        // Branch index read from the user, -1 if it names no branch
+        int branch;
+        cout << prompt;
+        cin >> branch;
+        cin.ignore();
+        return branch >= 0 && branch < branchCount() ? branch : -1;
+    }
+
+    void displayNetworkMenu()
+    {
+        int choice;
+        do
+        {
+            cout << "\nBranch Network:" << endl;
+            for (int b = 0; b < branchCount(); b++)
+                cout << "  [" << b << "] " << branchName(b) << endl;
+            cout << "1. Open a Branch" << endl;
+            cout << "2. Find Available Copies of a Book" << endl;
+            cout << "3. Transfer a Copy Between Branches" << endl;
+            cout << "4. Fill a Branch's Holds From Other Branches" << endl;
+            cout << "0. Exit" << endl;
+            cout << "Enter your choice: ";
+            cin >> choice;
+            cin.ignore(); // Clear input buffer
+
+            switch (choice)
+            {
+            case 1:
+            {
+                int branch = askBranch("Enter branch number: ");
+                if (branch < 0)
+                {
+                    cout << "No such branch." << endl;
+                    break;
+                }
+                withBranch(branch, [](LibraryManagementSystem &library)
+                           { library.displayMainMenu(); });
+                break;
+            }
+            case 2:
+            {
+                int bookID;
+                cout << "Enter Book ID: ";
+                cin >> bookID;
+                vector<BranchAvailability> copies = findAvailableCopies(bookID);
+                if (copies.empty())
+                    cout << "No branch has a copy available." << endl;
+                for (const BranchAvailability &copy : copies)
+                    cout << branchName(copy.branch) << ": " << copy.availableCopies << " available" << endl;
+                break;
+            }
+            case 3:
+            {
+                int bookID;
+                cout << "Enter Book ID: ";
+                cin >> bookID;
+                int from = askBranch("From branch number: ");
+                int to = askBranch("To branch number: ");
+                if (from >= 0 && to >= 0 && transferCopy(bookID, from, to))
+                    cout << "Copy transferred." << endl;
+                else
+                    cout << "Failed to transfer copy." << endl;
+                break;
+            }
+            case 4:
+            {
+                int branch = askBranch("Enter branch number: ");
+                if (branch < 0)
+                {
+                    cout << "No such branch." << endl;
+                    break;
+                }
+                cout << fulfilPendingReservations(branch) << " copies transferred to fill holds." << endl;
+                break;
+            }
+            case 0:
+                cout << "Exiting the system. Goodbye!" << endl;
+                break;
+            default:
+                cout << "Invalid choice. Please try again." << endl;
+            }
+        } while (choice != 0);
+    }
+};
+
+// =====================================================
+// Workload Replay
+// =====================================================
+
+struct ReplayReport
+{
+    long long calls = 0;                      // Calls replayed
+    long long lateMicros = 0;                 // Worst delay behind the trace's schedule
+    map<string, vector<long long>> latencies; // Operation name -> call latencies in microseconds
+};
+
+class WorkloadReplayer
+{
+public:
+    static bool replay(LibraryManagementSystem &library, const string &traceFile, double speed, ReplayReport &report)
+    {
+        // speed 1 keeps the original pacing, 2 runs twice as fast, 0 replays back to back.
+        // The library is first replaced by the state the trace was recorded against.
+        WorkloadTrace trace;
+        LibrarySnapshot snapshot;
+        if (!trace.open(traceFile))
+            return false;
+        istringstream state(trace.initialState);
+        if (!LibraryManagementSystem::readSnapshot(state, snapshot))
+            return false;
+        library.installSnapshot(snapshot);
+
+        auto start = chrono::steady_clock::now();
+        TraceRecord r;
+        while (trace.next(r))
+        {
+            if (speed > 0)
+            {
+                auto due = start + chrono::microseconds((long long)(r.micros / speed));
+                this_thread::sleep_until(due);
+                long long late = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - due).count();
+                report.lateMicros = max(report.lateMicros, late);
+            }
+            library.setVirtualClock(trace.wallStart + r.micros / 1000000);
+
+            auto before = chrono::steady_clock::now();
+            run(library, r);
+            long long elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - before).count();
+            report.latencies[traceNames[r.op]].push_back(elapsed);
+            report.calls++;
+        }
+        library.setVirtualClock(0);
+        return true;
+    }
+
+    static void run(LibraryManagementSystem &library, const TraceRecord &r)
+    {
+        const vector<long long> &n = r.ints;
+        const vector<string> &t = r.texts;
+        switch (r.op)
+        {
+        case TraceSearchTitle:
+            library.searchBooksByTitle(t[0]);
+            break;
+        case TraceAutocomplete:
+            library.autocompleteBooks(t[0], n[0]);
+            break;
+        case TraceFuzzy:
+            library.fuzzySearchBooks(t[0], n[0], n[1], n[2]);
+            break;
+        case TraceFullText:
+            library.searchDescriptions(t[0], n[0]);
+            break;
+        case TraceCategory:
+            library.filterBooksByCategory(t[0]);
+            break;
+        case TraceAddBook:
+        {
+            Book book;
+            book.id = n[0];
+            book.title = t[0];
+            book.author = t[1];
+            book.category = t[2];
+            book.description = t[3];
+            book.totalCopies = n[1];
+            library.addBook(book);
+            break;
+        }
+        case TraceUpdateBook:
+            library.updateBookDetails(n[0], t[0], t[1], t[2]);
+            break;
+        case TraceRemoveBook:
+            library.removeBook(n[0]);
+            break;
+        case TraceBorrow:
+            library.borrowBook(n[0], t[0]);
+            break;
+        case TraceReturn:
+            library.returnBook(n[0], t[0], t[1]);
+            break;
+        case TraceRenew:
+            library.renewBook(n[0], t[0]);
+            break;
+        case TraceReserve:
+            library.reserveBook(n[0], t[0]);
+            break;
+        case TraceTransfer:
+            library.transferLoan(n[0], t[0], t[1]);
+            break;
+        case TraceExchange:
+            library.exchangeBook(n[0], t[0], t[1], n[1]);
+            break;
+        case TraceRegister:
+        {
+            Student student;
+            student.id = t[0];
+            student.name = t[1];
+            student.phoneNumber = t[2];
+            student.email = t[3];
+            student.patronClass = n[0];
+            library.registerStudent(student);
+            break;
+        }
+        case TraceFine:
+            library.calculateTotalFine(t[0]);
+            break;
+        case TraceSort:
+            library.sortBooksByTitle();
+            break;
+        default:
+            break;
+        }
+    }
+
+    static void display(ReplayReport &report)
+    {
+        cout << "\n=========== REPLAY LATENCY (us) ===========\n";
+        cout << "Calls replayed : " << report.calls << endl;
+        cout << "Worst lag      : " << report.lateMicros << " us behind schedule" << endl;
+        cout << left << setw(14) << "Operation" << setw(10) << "Calls" << setw(10) << "p50"
+             << setw(10) << "p99" << setw(10) << "Max" << endl;
+        for (auto &entry : report.latencies)
+        {
+            vector<long long> &samples = entry.second;
+            sort(samples.begin(), samples.end());
+            cout << left << setw(14) << entry.first << setw(10) << samples.size()
+                 << setw(10) << samples[samples.size() / 2]
+                 << setw(10) << samples[min(samples.size() - 1, samples.size() * 99 / 100)]
+                 << setw(10) << samples.back() << endl;
+        }
+        cout << "===========================================\n";
+    }
+};
+
+// =====================================================
+// Synthetic Catalog (generated books for the benchmarks)
+// =====================================================
+
+struct SyntheticCatalog
+{
+    vector<string> words;      // Made-up words titles and descriptions are drawn from
+    vector<string> surnames;   // Made-up author surnames
+    vector<string> categories; // "Category 0" .. "Category 299"
+    vector<Book> books;        // IDs 1..bookCount
+
+    explicit SyntheticCatalog(int bookCount)
+        : words(20000), surnames(100000), categories(300), books(bookCount)
+    {
+        // Same seed every run, so benchmark runs compare like with like
+        mt19937 random(42);
+        auto pick = [&](int n)
+        { return (int)(random() % n); };
+        const char *syllables[] = {"ka", "lo", "mi", "ren", "sa", "tor", "vel", "an", "is", "or", "dun", "bri", "ca", "es", "mar", "tha"};
+        auto makeWord = [&](int parts)
+        {
+            string word;
+            for (int i = 0; i < parts; i++)
+                word += syllables[pick(16)];
+            return word;
+        };
+        for (string &word : words)
+            word = makeWord(2 + pick(2));
+        for (string &surname : surnames)
+            surname = makeWord(3);
+        for (int c = 0; c < (int)categories.size(); c++)
+            categories[c] = "Category " + to_string(c);
+        auto phrase = [&](int length)
+        {
+            string text = words[pick(words.size())];
+            for (int i = 1; i < length; i++)
+                text += " " + words[pick(words.size())];
+            return text;
+        };
+
+        for (int i = 0; i < bookCount; i++)
+        {
+            books[i].id = i + 1;
+            books[i].title = phrase(2 + pick(4));
+            books[i].author = string(1, 'A' + pick(26)) + ". " + surnames[pick(surnames.size())];
+            books[i].category = categories[pick(categories.size())];
+            books[i].description = phrase(10 + pick(16));
+            books[i].totalCopies = 1 + pick(3);
+        }
+    }
+};
+
+void displayLatencies(const string &name, vector<long long> &samples)
+{
+    // One row of a Calls/p50/p99/Max table, in the units the samples were taken in
+    sort(samples.begin(), samples.end());
+    cout << left << setw(26) << name << setw(10) << samples.size()
+         << setw(10) << samples[samples.size() / 2]
+         << setw(10) << samples[min(samples.size() - 1, samples.size() * 99 / 100)]
+         << setw(10) << samples.back() << endl;
+}
+
+// =====================================================
+// Memory Benchmark (synthetic catalog, RSS against lookup latency)
+// =====================================================
+
+void runMemoryBenchmark(int bookCount)
+{
+    // Loads a generated catalog and reports memory per subsystem and search latencies; run
+    // from a plain and a compact build to compare. Nothing is written to disk.
+    LibraryManagementSystem lms("");
+    auto start = chrono::steady_clock::now();
+    SyntheticCatalog catalog(bookCount);
+    lms.addBooks(catalog.books);
+    catalog.books.clear();
+    catalog.books.shrink_to_fit();
+    double loadSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    const vector<string> &words = catalog.words, &categories = catalog.categories;
+
+    cout << "Books: " << bookCount << ", loaded in " << fixed << setprecision(1) << loadSeconds << " s" << defaultfloat << endl;
+    lms.displayMemoryUsage();
+
+    auto timeQueries = [&](const string &name, int runs, function<size_t(int)> query)
+    {
+        size_t found = 0;
+        auto begin = chrono::steady_clock::now();
+        for (int r = 0; r < runs; r++)
+            found += query(r);
+        double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - begin).count() / runs;
+        cout << left << setw(26) << name << right << setw(12) << fixed << setprecision(1) << micros << " us/query"
+             << setw(10) << found / runs << " hits" << defaultfloat << left << endl;
+    };
+    cout << "\n=========== LATENCY ===========\n";
+    timeQueries("title substring scan", 20, [&](int r)
+                { return lms.searchBooksByTitle(words[r * 7919 % words.size()]).size(); });
+    timeQueries("category scan", 20, [&](int r)
+                { return lms.filterBooksByCategory(categories[r]).size(); });
+    timeQueries("autocomplete", 200, [&](int r)
+                { return lms.autocompleteBooks(words[r * 31 % words.size()].substr(0, 3)).size(); });
+    timeQueries("fuzzy search", 50, [&](int r)
+                { string typo = words[r * 131 % words.size()] + words[r * 17 % words.size()];
+                  typo[1] = 'x';
+                  return lms.fuzzySearchBooks(typo).size(); });
+    timeQueries("full-text search", 200, [&](int r)
+                { return lms.searchDescriptions(words[r * 61 % words.size()] + " " + words[r * 89 % words.size()]).size(); });
+
+    // Decompression cost on its own: read title and description of books a category lists
+    vector<Book *> sample = lms.filterBooksByCategory(categories[299]);
+    size_t characters = 0;
+    auto length = [](const string &text)
+    { return text.size(); };
+    auto begin = chrono::steady_clock::now();
+    for (int round = 0; round < 10; round++)
+    {
+        for (Book *book : sample)
+            characters += book->title.read(length) + book->description.read(length);
+    }
+    double nanos = chrono::duration<double, nano>(chrono::steady_clock::now() - begin).count() / (20.0 * sample.size());
+    cout << left << setw(26) << "field access" << right << setw(12) << fixed << setprecision(1) << nanos << " ns/field"
+         << defaultfloat << left << " (" << characters / 10 << " characters per round)" << endl;
+    cout << "===============================\n";
+}
+
+// =====================================================
+// Autocomplete Benchmark (latency per keystroke)
+// =====================================================
+
+void runAutocompleteBenchmark(int bookCount)
+{
+    // Types generated titles and authors one character at a time and times the completion
+    // each keystroke asks for, with a borrow after each text so the top lists keep moving.
+    // The index is timed on its own and behind the library call, which also looks the
+    // books up by ID.
+    SyntheticCatalog catalog(bookCount);
+    TitleAutocomplete index;
+    for (const Book &book : catalog.books)
+        index.addBook(book);
+
+    LibraryManagementSystem lms("");
+    lms.addBooks(catalog.books);
+    Student reader;
+    reader.id = "S001";
+    reader.name = "Bench Reader";
+    lms.registerStudent(reader);
+    lms.autocompleteBooks(""); // waits for the index build
+
+    mt19937 random(7);
+    vector<long long> indexOnly, libraryCall;
+    for (int typed = 0; typed < 2000; typed++)
+    {
+        const Book &book = catalog.books[random() % bookCount];
+        string text = typed % 4 == 3 ? book.author.str() : book.title.str();
+        for (size_t length = 1; length <= text.size(); length++)
+        {
+            string prefix = text.substr(0, length);
+            auto begin = chrono::steady_clock::now();
+            index.complete(prefix, 5);
+            auto middle = chrono::steady_clock::now();
+            lms.autocompleteBooks(prefix);
+            auto end = chrono::steady_clock::now();
+            indexOnly.push_back(chrono::duration_cast<chrono::nanoseconds>(middle - begin).count());
+            libraryCall.push_back(chrono::duration_cast<chrono::nanoseconds>(end - middle).count());
+        }
+        index.recordBorrow(book.id);
+        if (lms.borrowBook(book.id, "S001"))
+            lms.returnBook(book.id, "S001", lms.getCurrentDate());
+    }
+
+    size_t indexBytes = index.memoryBytes();
+    cout << "Books: " << bookCount << ", autocomplete index " << fixed << setprecision(1) << indexBytes / 1048576.0
+         << " MB (" << indexBytes / max(1, bookCount) << " bytes per book)" << defaultfloat << endl;
+    cout << "\n=========== AUTOCOMPLETE LATENCY (ns) ===========\n";
+    cout << left << setw(26) << "Keystroke" << setw(10) << "Calls" << setw(10) << "p50"
+         << setw(10) << "p99" << setw(10) << "Max" << endl;
+    displayLatencies("index", indexOnly);
+    displayLatencies("library call", libraryCall);
+    cout << "=================================================\n";
+}
+
+// =====================================================
+// Fuzzy Search Benchmark (index against brute-force edit distance)
+// =====================================================
+
+void runFuzzyBenchmark(int bookCount, bool withDescriptions)
+{
+    // Misspells words and phrases taken from the generated books, then asks the index for the
+    // closest books and computes the edit distance against every book's normalized title and
+    // author, and description if asked, by brute force. Recall is the share of the brute-force
+    // top results, ranked by distance and then catalog order, the index returns too. Without
+    // descriptions the generated ones are dropped before indexing, so millions of books fit.
+    SyntheticCatalog catalog(bookCount);
+    FuzzyIndex index;
+    int fieldCount = withDescriptions ? FuzzyFieldCount : FuzzyDescription;
+    vector<array<string, FuzzyFieldCount>> fields(bookCount);
+    for (int i = 0; i < bookCount; i++)
+    {
+        Book &book = catalog.books[i];
+        if (!withDescriptions)
+            book.description = "";
+        index.addBook(book);
+        fields[i] = {normalizeText(book.title.str()), normalizeText(book.author.str()), normalizeText(book.description.str())};
+    }
+    catalog.books = vector<Book>(); // Book i + 1 is fields[i] from here on
+    index.search(fields[0][FuzzyTitle], 1, withDescriptions); // Untimed, so cold caches are not charged to the first query
+
+    mt19937 random(11);
+    const string alphabet = "abcdefghijklmnopqrstuvwxyz";
+    vector<long long> indexMicros, bruteMicros;
+    size_t expected = 0, found = 0, extra = 0, matched = 0;
+    for (int q = 0; q < 40; q++)
+    {
+        // Lengths from 2 to about 20 characters, each misspelled within its edit budget
+        const string &text = fields[random() % bookCount][q % 3 == 0 ? FuzzyAuthor : (q % 3 == 2 && withDescriptions ? FuzzyDescription : FuzzyTitle)];
+        int length = min<int>(text.size(), 2 + q / 2);
+        int start = random() % (text.size() - length + 1);
+        string query = text.substr(start, length);
+        int budget = FuzzyIndex::defaultDistance(query.size());
+        for (int edit = random() % (budget + 1); edit > 0; edit--)
+        {
+            int at = random() % query.size();
+            if (random() % 2)
+                query[at] = alphabet[random() % alphabet.size()];
+            else
+                query.insert(query.begin() + at, alphabet[random() % alphabet.size()]);
+        }
+
+        auto begin = chrono::steady_clock::now();
+        vector<FuzzyMatch> matches = index.search(query, budget, withDescriptions);
+        auto middle = chrono::steady_clock::now();
+        vector<FuzzyMatch> brute;
+        string pattern = normalizeText(query);
+        for (int i = 0; i < bookCount; i++)
+        {
+            int best = budget + 1;
+            for (int f = 0; f < fieldCount; f++)
+                best = min(best, FuzzyIndex::searchDistanceDP(pattern, fields[i][f]));
+            if (best <= budget)
+                brute.push_back({i + 1, best});
+        }
+        stable_sort(brute.begin(), brute.end(), [](const FuzzyMatch &a, const FuzzyMatch &b)
+                    { return a.distance < b.distance; });
+        matched += brute.size();
+        brute.resize(min<size_t>(brute.size(), fuzzyTopK));
+        auto end = chrono::steady_clock::now();
+        indexMicros.push_back(chrono::duration_cast<chrono::microseconds>(middle - begin).count());
+        bruteMicros.push_back(chrono::duration_cast<chrono::microseconds>(end - middle).count());
+
+        expected += brute.size();
+        for (size_t i = 0; i < matches.size(); i++)
+        {
+            if (i < brute.size() && brute[i].bookID == matches[i].bookID && brute[i].distance == matches[i].distance)
+                found++;
+            else
+                extra++;
+        }
+    }
+
+    cout << "Books: " << bookCount << (withDescriptions ? " (titles, authors, descriptions)" : " (titles, authors)")
+         << ", fuzzy index " << fixed << setprecision(1) << index.memoryBytes() / 1048576.0 << " MB" << defaultfloat << endl;
+    cout << "Brute force matched " << matched / 40 << " books per query on average" << endl;
+    cout << "Recall: " << found << " of " << expected << " brute-force top-" << fuzzyTopK << " results";
+    if (extra)
+        cout << ", " << extra << " results brute force does not agree with";
+    cout << endl;
+    cout << "\n=========== FUZZY SEARCH LATENCY (us) ===========\n";
+    cout << left << setw(26) << "Query" << setw(10) << "Calls" << setw(10) << "p50"
+         << setw(10) << "p99" << setw(10) << "Max" << endl;
+    displayLatencies("fuzzy index", indexMicros);
+    displayLatencies("brute force", bruteMicros);
+    cout << "=================================================\n";
+}
+
+// =====================================================
+// Patron Policy Benchmark (policy lookups against the old global limits)
+// =====================================================
+
+void runPolicyBenchmark(int patronCount)
+{
+    // Times the loan-limit check three ways over the same patrons: against the global
+    // constants every patron used to share, through withPolicy for the built-in classes,
+    // and through withPolicy for a custom class. Then times whole borrow/return cycles.
+    LibraryManagementSystem lms("");
+    int customClass = lms.registerPatronClass({6, 4, 21, 1, 3, 15});
+
+    mt19937 random(5);
+    vector<Student> builtIn(patronCount), custom(patronCount);
+    for (int i = 0; i < patronCount; i++)
+    {
+        builtIn[i].id = "B" + to_string(i);
+        builtIn[i].patronClass = i % BuiltInPatronClasses;
+        custom[i].id = "C" + to_string(i);
+        custom[i].patronClass = customClass;
+        for (int slot = 0; slot < maxBorrows; slot++)
+        {
+            int bookID = random() % 3 == 0 ? 1 + slot : 0; // about a third of the slots in use
+            builtIn[i].borrowedBooks[slot].bookID = bookID;
+            custom[i].borrowedBooks[slot].bookID = bookID;
+        }
+    }
+
+    const int rounds = 200;
+    auto timeChecks = [&](const string &name, vector<Student> &patrons, auto check)
+    {
+        // Generic, so each check is compiled into its own loop
+        long long allowed = 0;
+        auto begin = chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++)
+        {
+            for (const Student &patron : patrons)
+                allowed += check(patron);
+        }
+        double nanos = chrono::duration<double, nano>(chrono::steady_clock::now() - begin).count() / ((double)rounds * patrons.size());
+        cout << left << setw(26) << name << right << setw(10) << fixed << setprecision(2) << nanos << " ns/check"
+             << setw(12) << allowed / rounds << " allowed" << defaultfloat << left << endl;
+    };
+
+    cout << "Patrons: " << patronCount << " per row, " << rounds << " rounds" << endl;
+    cout << "\n=========== LOAN LIMIT CHECK ===========\n";
+    timeChecks("global constants", builtIn, [](const Student &patron)
+               { return LibraryManagementSystem::activeLoans(patron) < maxBorrows; });
+    timeChecks("built-in class policy", builtIn, [&](const Student &patron)
+               { return lms.withPolicy(patron, [&](auto policy)
+                                       { return LibraryManagementSystem::activeLoans(patron) < policy.maxBorrows; }); });
+    timeChecks("custom class policy", custom, [&](const Student &patron)
+               { return lms.withPolicy(patron, [&](auto policy)
+                                       { return LibraryManagementSystem::activeLoans(patron) < policy.maxBorrows; }); });
+
+    // Whole cycles: borrowBook and returnBook look the class up once each
+    Book book;
+    book.id = 1;
+    book.title = "Bench Copy";
+    book.totalCopies = 2 * patronCount;
+    lms.addBook(book);
+    int cyclePatrons = min(patronCount, 1000); // lookups by ID are linear; keep them short
+    for (int i = 0; i < cyclePatrons; i++)
+    {
+        Student patron;
+        patron.id = "B" + to_string(i);
+        patron.patronClass = i % BuiltInPatronClasses;
+        lms.registerStudent(patron);
+        patron.id = "C" + to_string(i);
+        patron.patronClass = customClass;
+        lms.registerStudent(patron);
+    }
+    string today = lms.getCurrentDate();
+    for (const char *prefix : {"B", "C"})
+    {
+        auto begin = chrono::steady_clock::now();
+        for (int round = 0; round < 10; round++)
+        {
+            for (int i = 0; i < cyclePatrons; i++)
+            {
+                string id = prefix + to_string(i);
+                lms.borrowBook(1, id);
+                lms.returnBook(1, id, today);
+            }
+        }
+        double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - begin).count() / (10.0 * cyclePatrons);
+        cout << left << setw(26) << (prefix[0] == 'B' ? "built-in borrow+return" : "custom borrow+return") << right << setw(10)
+             << fixed << setprecision(2) << micros << " us/cycle" << defaultfloat << left << endl;
+    }
+    cout << "========================================\n";
+}
+
+// =====================================================
+// Self Check (behaviour that is easy to break without noticing)
+// =====================================================
+
+int runSelfCheck()
+{
+    // Prints one line per check and returns the number that failed
+    int failures = 0;
+    auto check = [&](const string &name, bool passed)
+    {
+        cout << left << setw(48) << name << (passed ? "ok" : "FAILED") << endl;
+        failures += !passed;
+    };
+
+    // Data files of every format the loader accepts. The first saves had no header line,
+    // six fields per book, five per student and no reservation dates.
+    LibrarySnapshot baseline;
+    istringstream baselineFile("Books:\n"
+                               "1,DSA,Mark Allen Weiss,Computer Science,3,2\n"
+                               "2,Clean Code,Robert C. Martin,Software Engineering,4,4\n"
+                               "\nStudents:\n"
+                               "S001,Alice,alice@example.com,0911111111,5\n"
+                               "\nReservations:\n"
+                               "1,S001\n");
+    check("baseline data file loads", LibraryManagementSystem::readSnapshot(baselineFile, baseline));
+    check("baseline books keep their copy counts", baseline.books.size() == 2 && baseline.books[0].availableCopies == 2 &&
+                                                       baseline.books[1].totalCopies == 4);
+    check("baseline books have no description", baseline.books.size() == 2 && baseline.books[1].description.str().empty());
+    check("baseline students and holds load", baseline.students.size() == 1 && baseline.students[0].fine == 5 &&
+                                                  baseline.reservedBooks.size() == 1);
+
+    // Later saves without a header put an unescaped description after the copy counts
+    LibrarySnapshot interim;
+    istringstream interimFile("Books:\n1,DSA,Mark Allen Weiss,Computer Science,3,3,Core DSA, and more\n");
+    check("headerless description keeps its commas", LibraryManagementSystem::readSnapshot(interimFile, interim) &&
+                                                          interim.books.size() == 1 &&
+                                                          interim.books[0].description.str() == "Core DSA, and more");
+
+    LibrarySnapshot current = baseline;
+    current.books[0].description = "First line, with a comma\nsecond line";
+    current.books[0].borrowCount = 7;
+    ostringstream written;
+    LibraryManagementSystem::writeSnapshot(current, written);
+    LibrarySnapshot reread;
+    istringstream rereadFile(written.str());
+    check("current format reads back what it wrote", LibraryManagementSystem::readSnapshot(rereadFile, reread) &&
+                                                         reread.books.size() == 2 && reread.books[0].borrowCount == 7 &&
+                                                         reread.books[0].description.str() == current.books[0].description.str());
+
+    LibrarySnapshot truncated;
+    istringstream truncatedFile("Books:\n1,DSA,Mark Allen Weiss,3,2\n");
+    check("short book line is refused", !LibraryManagementSystem::readSnapshot(truncatedFile, truncated));
+
+    LibraryManagementSystem lms("");
+    LibrarySnapshot installed = baseline;
+    lms.installSnapshot(installed);
+    Book *book = lms.searchBookById(1);
+    check("installed baseline library lends its books", book && book->availableCopies == 2 && lms.borrowBook(1, "S001") &&
+                                                            book->availableCopies == 1);
+
+    // Transactions. A change landing between staging and commit must be caught, and the
+    // workflow staged again from the changed records.
+    auto deskWith = [](LibraryManagementSystem &desk, int patrons)
+    {
+        Book copy;
+        copy.id = 1;
+        copy.title = "Shared Copy";
+        copy.totalCopies = 1;
+        desk.addBook(copy);
+        for (int i = 0; i < patrons; i++)
+        {
+            Student patron;
+            patron.id = "P" + to_string(i);
+            desk.registerStudent(patron);
+        }
+        desk.borrowBook(1, "P0");
+    };
+    LibraryManagementSystem desk("");
+    deskWith(desk, 2);
+    int attempts = 0;
+    bool moved = desk.runTransaction([&](LibraryTransaction &tx)
+                                     {
+        bool staged = desk.stageTransfer(tx, 1, "P0", "P1");
+        if (++attempts == 1)
+            desk.renewBook(1, "P0"); // another desk changes the loan after it was read
+        return staged; });
+    TransactionStats stats = desk.getTransactionStats();
+    check("a change after staging forces a retry", moved && attempts == 2 && stats.conflicts == 1 && stats.committed == 1);
+    check("the retry commits on the changed records", desk.loanSlot(*desk.findStudentById("P0"), 1) < 0 &&
+                                                          desk.loanSlot(*desk.findStudentById("P1"), 1) >= 0 &&
+                                                          desk.searchBookById(1)->availableCopies == 0);
+
+    // Transfers of one copy racing on worker threads, as the server runs them: every commit
+    // must see the previous one, so exactly one patron ends up with the copy and no borrow is lost
+    LibraryManagementSystem racing("");
+    const int patrons = 8, rounds = 300;
+    deskWith(racing, patrons);
+    shared_mutex lock;
+    atomic<long long> transfers{0};
+    vector<thread> threads;
+    for (int t = 0; t < patrons; t++)
+    {
+        threads.emplace_back([&, t]
+                             {
+            for (int round = 0; round < rounds; round++)
+            {
+                for (int from = 0; from < patrons; from++)
+                {
+                    string to = "P" + to_string((from + 1 + t % (patrons - 1)) % patrons);
+                    transfers += racing.transferLoan(1, "P" + to_string(from), to, &lock);
+                }
+            } });
+    }
+    for (thread &worker : threads)
+        worker.join();
+    int holders = 0;
+    for (int i = 0; i < patrons; i++)
+        holders += racing.loanSlot(*racing.findStudentById("P" + to_string(i)), 1) >= 0;
+    stats = racing.getTransactionStats();
+    check("racing transfers leave one loan of the copy", holders == 1 && racing.searchBookById(1)->availableCopies == 0);
+    check("racing transfers lose no borrow", racing.searchBookById(1)->borrowCount == 1 + transfers &&
+                                                 stats.committed == transfers);
+    cout << "(" << transfers << " transfers committed, " << stats.conflicts << " restaged after a conflict)" << endl;
+
+    // Acquisition ranking. A title whose last copy is gone has holds that never fill, so it
+    // must rank first, ahead of a busier title that still has a copy.
+    DemandTracker demand;
+    demand.updateCopies(7, 0);
+    demand.updateQueue(7, 2);
+    demand.updateCopies(8, 1);
+    demand.updateQueue(8, 5);
+    demand.updateCopies(9, 2); // no holds, nothing to save
+    vector<DemandEstimate> candidates = demand.topCandidates(3, 100);
+    check("a title with no copies ranks first", candidates.size() == 2 && candidates[0].bookID == 7 &&
+                                                    isinf(candidates[0].waitSaved) && candidates[1].bookID == 8 &&
+                                                    candidates[1].waitSaved > 0);
+
+    // Circulation log damage. A chunk naming a student the file never defined is dropped; a
+    // size prefix claiming 4 GiB ends the log without allocating it, and is cut off so the
+    // next run's appends read back.
+    const string logFile = "self_check_events.bin";
+    remove(logFile.c_str());
+    {
+        CirculationLog log(logFile);
+        log.append(EventBorrow, 100, 1, "S001", "Computer Science");
+        log.append(EventReturn, 103, 1, "S001", "Computer Science", 3);
+    }
+    {
+        ofstream file(logFile, ios::binary | ios::app);
+        const char badChunk[] = {'C', 1, 0, 0, 0, 1, 0, 0, 0, 2, 1, 0, 0, 0, 0, 1, 0, 0, 0, 2,
+                                 1, 0, 0, 0, 0x7E, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0}; // student ref 63
+        const char hugeName[] = {'S', '\xFF', '\xFF', '\xFF', '\xFF', 'x'};
+        file.write(badChunk, sizeof(badChunk));
+        file.write(hugeName, sizeof(hugeName));
+    }
+    long long reloaded = 0, appended = 0;
+    {
+        CirculationLog log(logFile);
+        reloaded = log.eventCount();
+        log.append(EventBorrow, 104, 2, "S002", "Fiction");
+    }
+    {
+        CirculationLog log(logFile);
+        appended = log.eventCount();
+    }
+    remove(logFile.c_str());
+    check("a damaged event log keeps its whole chunks", reloaded == 2 && appended == 3);
+
+    // Query cache. A repeated query is answered from the cache, but never after the field
+    // it filters on has changed.
+    LibraryManagementSystem shelf("");
+    for (int id = 1; id <= 3; id++)
+    {
+        Book volume;
+        volume.id = id;
+        volume.title = "Volume " + to_string(id);
+        volume.category = id == 3 ? "History" : "Fiction";
+        volume.totalCopies = 1;
+        shelf.addBook(volume);
+    }
+    size_t fictionBefore = shelf.filterBooksByCategory("Fiction").size();
+    shelf.filterBooksByCategory("History");
+    long long hitsBefore = shelf.getQueryCacheStats().hits;
+    shelf.filterBooksByCategory("Fiction");
+    check("a repeated filter is a cache hit", fictionBefore == 2 && shelf.getQueryCacheStats().hits == hitsBefore + 1);
+    shelf.updateBookDetails(2, "Volume 2", "", "History");
+    vector<Book *> fiction = shelf.filterBooksByCategory("Fiction"), history = shelf.filterBooksByCategory("History");
+    check("a category change reaches cached filters", fiction.size() == 1 && fiction[0]->id == 1 && history.size() == 2);
+    shelf.searchBooksByTitle("Volume 2");
+    shelf.updateBookDetails(2, "Atlas", "", "History");
+    vector<Book *> atlas = shelf.searchBooksByTitle("Atlas");
+    check("a title change reaches cached searches", shelf.searchBooksByTitle("Volume 2").empty() && atlas.size() == 1 &&
+                                                        atlas[0]->id == 2);
+
+    // Fines on the ledger, read the way the report reads them. Undergraduates pay 2 a day
+    // after one day of grace, at most 20 a loan; staff pay 1 a day after two, at most 10.
+    LibraryManagementSystem fines("");
+    Book popular;
+    popular.id = 1;
+    popular.title = "Popular";
+    popular.totalCopies = 3;
+    fines.addBook(popular);
+    for (const char *id : {"U", "R"})
+    {
+        Student patron;
+        patron.id = id;
+        fines.registerStudent(patron);
+    }
+    Student staff;
+    staff.id = "T";
+    staff.patronClass = Staff;
+    fines.registerStudent(staff);
+
+    tm noon{};
+    noon.tm_year = 2026 - 1900;
+    noon.tm_mon = 2;
+    noon.tm_mday = 2;
+    noon.tm_hour = 12;
+    noon.tm_isdst = -1;
+    time_t borrowed = mktime(&noon);
+    int borrowDay = dayNumber("2026-03-02");
+    auto owing = [&](int days, int threshold)
+    {
+        // Patrons owing more than threshold, days after the borrows, largest first
+        fines.setVirtualClock(borrowed + days * 86400);
+        return fines.getPatronsWithFinesOver(threshold);
+    };
+    fines.setVirtualClock(borrowed);
+    for (const char *id : {"U", "R", "T"})
+        fines.borrowBook(1, id);
+    fines.setVirtualClock(borrowed + 6 * 86400);
+    bool returned = fines.returnBook(1, "R", dateOfDay(borrowDay + 6)); // two days past grace
+
+    using Owing = vector<pair<string, int>>;
+    check("no fine within the grace day", returned && owing(4, 0) == Owing{{"R", 4}});
+    check("fines accrue per day after grace", owing(5, 0) == Owing{{"R", 4}, {"U", 2}} &&
+                                                  owing(8, 0) == Owing{{"U", 8}, {"R", 4}});
+    check("fines stop at the class cap", owing(14, 0) == Owing{{"U", 20}, {"R", 4}} &&
+                                             owing(40, 0) == Owing{{"U", 20}, {"T", 10}, {"R", 4}});
+    check("the fine report applies its threshold", owing(40, 9) == Owing{{"U", 20}, {"T", 10}} &&
+                                                       owing(40, 20).empty());
+
+    // The ledger on its own: 3 a day from day 103, capped at 10 on day 106
+    FineLedger ledger;
+    ledger.openLoan("A", 0, 100, 3, 2, 10);
+    check("ledger quotes a return on any day", ledger.closingFine("A", 0, 102) == 0 && ledger.closingFine("A", 0, 103) == 3 &&
+                                                   ledger.closingFine("A", 0, 105) == 9 && ledger.closingFine("A", 0, 106) == 10);
+    ledger.tick(104);
+    int midway = ledger.accrued("A", 104);
+    ledger.openLoan("A", 1, 100, 3, 2, 10);
+    ledger.openLoan("A", 1, 104, 3, 2, 10); // a slot holds one loan; the first is replaced
+    ledger.tick(108);
+    check("ledger accrues, caps and replaces loans", midway == 6 && ledger.accrued("A", 108) == 10 + 6);
+    int charged = ledger.closeLoan("A", 0, 108);
+    ledger.tick(120);
+    check("a closed loan stops accruing", charged == 10 && ledger.accrued("A", 120) == 10);
+
+    // BM25 over four descriptions. "graph" and "algorithms" occur in two books each, so
+    // both weigh ln 2; book 1 has them three times in all, and the three-word book 4
+    // outranks the five-word book 2 for one occurrence each. "herbs" occurs once, so its
+    // single match outweighs "graph" twice.
+    LibraryManagementSystem reading("");
+    const vector<string> descriptions = {"graph algorithms and graph theory", "a gentle introduction to algorithms",
+                                         "cooking with herbs", "graph paper notebook"};
+    for (size_t i = 0; i < descriptions.size(); i++)
+    {
+        Book described;
+        described.id = i + 1;
+        described.title = "Book " + to_string(i + 1);
+        described.description = descriptions[i];
+        described.totalCopies = 1;
+        reading.addBook(described);
+    }
+    auto ranked = [&](const string &query, int k)
+    {
+        vector<int> ids;
+        for (Book *match : reading.searchDescriptions(query, k))
+            ids.push_back(match->id);
+        return ids;
+    };
+    check("BM25 ranks by frequency, rarity and length", ranked("graph algorithms", 10) == vector<int>{1, 4, 2} &&
+                                                           ranked("Graph, ALGORITHMS!", 2) == vector<int>{1, 4} &&
+                                                           ranked("graph herbs", 10) == vector<int>{3, 1, 4});
+    check("BM25 ignores words it has never seen", ranked("herbs zeppelin", 10) == vector<int>{3} &&
+                                                      ranked("zeppelin", 10).empty());
+
+    // Typeahead: any word of the title or author completes, most borrowed first, ties by ID
+    TitleAutocomplete typeahead;
+    const vector<tuple<int, string, string, int>> shelfTitles = {{1, "Data Structures", "Mark Weiss", 5},
+                                                                 {2, "Database Systems", "Ramez Elmasri", 9},
+                                                                 {3, "Dune", "Frank Herbert", 1},
+                                                                 {4, "The Art of Data", "Knuth", 0},
+                                                                 {5, "Data and Data", "", 0}};
+    for (const auto &shelved : shelfTitles)
+    {
+        Book entry;
+        entry.id = get<0>(shelved);
+        entry.title = get<1>(shelved);
+        entry.author = get<2>(shelved);
+        entry.borrowCount = get<3>(shelved);
+        typeahead.addBook(entry);
+    }
+    check("typeahead ranks by borrows, each book once", typeahead.complete("Dat", 10) == vector<int>{2, 1, 4, 5} &&
+                                                            typeahead.complete("d", 2) == vector<int>{2, 1} &&
+                                                            typeahead.complete("data s", 10) == vector<int>{1});
+    check("typeahead completes author words", typeahead.complete("herb", 10) == vector<int>{3} &&
+                                                  typeahead.complete("zz", 10).empty());
+    for (int i = 0; i < 9; i++)
+        typeahead.recordBorrow(3);
+    Book renamed;
+    renamed.id = 2;
+    renamed.title = "Operating Systems";
+    renamed.borrowCount = 9;
+    typeahead.updateBook(renamed);
+    typeahead.removeBook(1);
+    check("typeahead follows borrows, edits and removals", typeahead.complete("d", 2) == vector<int>{3, 4} &&
+                                                               typeahead.complete("datab", 10).empty() &&
+                                                               typeahead.complete("oper", 10) == vector<int>{2} &&
+                                                               typeahead.complete("dat", 10) == vector<int>{4, 5});
+
+    // Fuzzy search: closest first, ties in the order books were indexed; descriptions only
+    // when asked. "Duet" holds "due", one deletion away from "dune".
+    FuzzyIndex typos;
+    const vector<tuple<int, string, string, string>> misspelt = {{1, "Dune", "Frank Herbert", ""},
+                                                                 {2, "Dunes of Arrakis", "Brian Herbert", ""},
+                                                                 {3, "Foundation", "Isaac Asimov", "a galactic empire falls"},
+                                                                 {4, "Duet", "Anne Sexton", ""}};
+    for (const auto &shelved : misspelt)
+    {
+        Book entry;
+        entry.id = get<0>(shelved);
+        entry.title = get<1>(shelved);
+        entry.author = get<2>(shelved);
+        entry.description = get<3>(shelved);
+        typos.addBook(entry);
+    }
+    auto closest = [&](const string &query, int maxDistance, bool withDescriptions, int k)
+    {
+        vector<pair<int, int>> found;
+        for (const FuzzyMatch &match : typos.search(query, maxDistance, withDescriptions, k))
+            found.push_back({match.bookID, match.distance});
+        return found;
+    };
+    check("fuzzy search ranks by edits, ties by index", closest("Dune", 1, false, 10) == vector<pair<int, int>>{{1, 0}, {2, 0}, {4, 1}} &&
+                                                           closest("dune", 1, false, 2) == vector<pair<int, int>>{{1, 0}, {2, 0}} &&
+                                                           closest("herbret", 2, false, 10) == vector<pair<int, int>>{{1, 2}, {2, 2}});
+    check("fuzzy search reads descriptions if asked", closest("asimof", 1, false, 10) == vector<pair<int, int>>{{3, 1}} &&
+                                                          closest("galactik", 1, false, 10).empty() &&
+                                                          closest("galactik", 1, true, 10) == vector<pair<int, int>>{{3, 1}});
+    Book retitled;
+    retitled.id = 2;
+    retitled.title = "Children of Dune";
+    retitled.author = "Frank Herbert";
+    typos.updateBook(retitled);
+    typos.removeBook(1);
+    check("fuzzy search follows edits and removals", closest("dune", 1, false, 10) == vector<pair<int, int>>{{2, 0}, {4, 1}} &&
+                                                         closest("arrakis", 1, false, 10).empty() &&
+                                                         closest("childern", 2, false, 10) == vector<pair<int, int>>{{2, 2}});
+    return failures;
+}
+
+// =====================================================
+// Networked Request Server (epoll event loop + search workers)
+// =====================================================
+
+#ifdef __linux__
+
+// Line protocol: one request per line, fields separated by '|', e.g. "BORROW|1|S001".
+// Every request gets exactly one reply, in request order per connection: "OK", "OK <text>",
+// "ERR <reason>", or "OK <n>" followed by n lines "id|title|author|category|available|total".
+class LibraryServer
+{
+private:
+    struct Reply
+    {
+        uint64_t sequence;  // Position of the request on its connection
+        bool ready = false; // Filled in (searches complete on a worker)
+        string text;        // Reply bytes
+    };
+
+    struct Connection
+    {
+        int fd;                    // Client socket
+        string input;              // Bytes read but not yet parsed into lines
+        string output;             // Replies waiting to be written
+        deque<Reply> replies;      // Replies in request order, some still being computed
+        uint64_t nextSequence = 0; // Sequence number of the next request
+        int searchesRunning = 0;   // Searches of this connection still on workers
+        bool writeRunning = false; // A TRANSFER or EXCHANGE of this connection is still on a worker
+        bool inputEnded = false;   // The client closed its side; lines already read still run
+        bool closing = false;      // QUIT, end of input or an overlong line; close once everything is written
+    };
+
+    struct Completion
+    {
+        uint64_t connection; // Connection the reply belongs to
+        uint64_t sequence;   // Request it answers
+        bool write;          // A workflow rather than a search
+        string text;         // Reply bytes
+    };
+
+    LibraryManagementSystem &library;
+    shared_mutex libraryLock;                        // Searches and workflow staging share it; changes and commits take it alone
+    int listenFd = -1, epollFd = -1, wakeFd = -1;    // Listening socket, epoll instance, worker wakeup
+    unordered_map<uint64_t, Connection> connections; // Open clients by connection ID
+    uint64_t nextConnectionId = 2;                   // 0 and 1 tag the listening socket and wakeFd
+    mutex completionLock;                            // Guards completions
+    vector<Completion> completions;                  // Replies finished by workers
+    bool running = true;                             // Cleared by SHUTDOWN
+    atomic<long long> requestsServed{0};             // Replies produced
+    WorkerPool workers;                              // Runs CPU-heavy searches; last, so it stops first
+
+    static vector<string> split(const string &line)
+    {
+        vector<string> fields;
+        stringstream stream(line);
+        string field;
+        while (getline(stream, field, '|'))
+            fields.push_back(field);
+        return fields;
+    }
+
+    static bool toInt(const string &text, int &value)
+    {
+        char *end;
+        long parsed = strtol(text.c_str(), &end, 10);
+        if (text.empty() || *end != '\0')
+            return false;
+        value = parsed;
+        return true;
+    }
+
+    static string bookList(const vector<Book *> &results)
+    {
+        string reply = "OK " + to_string(results.size()) + "\n";
+        for (const Book *b : results)
+        {
+            reply += to_string(b->id) + "|" + b->title.str() + "|" + b->author.str() + "|" + b->category.str() + "|" +
+                     to_string(b->availableCopies) + "|" + to_string(b->totalCopies) + "\n";
+        }
+        return reply;
+    }
+
+    static bool isSearch(const string &command)
+    {
+        return command == "SEARCH" || command == "FUZZY" || command == "FULLTEXT" || command == "CATEGORY";
+    }
+
+    static bool isWorkflow(const string &command)
+    {
+        return command == "TRANSFER" || command == "EXCHANGE";
+    }
+
+    string runSearch(const vector<string> &f)
+    {
+        // Runs on a worker; only reads the library
+        shared_lock<shared_mutex> guard(libraryLock);
+        if (f.size() < 2)
+            return "ERR missing query\n";
+        if (f[0] == "SEARCH")
+            return bookList(library.searchBooksByTitle(f[1]));
+        if (f[0] == "FUZZY")
+            return bookList(library.fuzzySearchBooks(f[1], -1, f.size() > 2 && f[2] == "all"));
+        if (f[0] == "FULLTEXT")
+            return bookList(library.searchDescriptions(f[1]));
+        return bookList(library.filterBooksByCategory(f[1]));
+    }
+
+    string runWorkflow(const vector<string> &f)
+    {
+        // Runs on a worker: stages under the shared lock, beside searches and the workflows of
+        // other connections, and holds the lock alone only to validate and commit. A commit
+        // that finds a record changed since staging stages again.
+        int bookID = 0, otherBook = 0;
+        bool hasBook = f.size() > 1 && toInt(f[1], bookID);
+        if (f[0] == "TRANSFER" && hasBook && f.size() == 4)
+            return library.transferLoan(bookID, f[2], f[3], &libraryLock) ? "OK\n" : "ERR rejected\n";
+        if (f[0] == "EXCHANGE" && hasBook && f.size() == 5 && toInt(f[4], otherBook))
+            return library.exchangeBook(bookID, f[2], f[3], otherBook, &libraryLock) ? "OK\n" : "ERR rejected\n";
+        return "ERR unknown command\n";
+    }
+
+    string runCommand(const vector<string> &f)
+    {
+        // Runs on the event loop; workflows commit from workers meanwhile, so every command
+        // that touches the library takes the lock
+        const string &command = f[0];
+        int bookID = 0;
+        bool hasBook = f.size() > 1 && toInt(f[1], bookID);
+
+        if (command == "PING")
+            return "OK PONG\n";
+        if (command == "BOOK" && hasBook)
+        {
+            shared_lock<shared_mutex> guard(libraryLock);
+            Book *book = library.searchBookById(bookID);
+            return book ? bookList({book}) : "ERR no such book\n";
+        }
+
+        unique_lock<shared_mutex> guard(libraryLock);
+        if (command == "FINE" && f.size() == 2)
+            return "OK " + to_string(library.calculateTotalFine(f[1])) + "\n"; // brings the ledger up to today
+        bool done = false;
+        if (command == "COMPLETE" && f.size() == 2)
+            return bookList(library.autocompleteBooks(f[1]));
+        else if (command == "BORROW" && hasBook && f.size() == 3)
+            done = library.borrowBook(bookID, f[2]);
+        else if (command == "RETURN" && hasBook && f.size() == 4)
+            done = library.returnBook(bookID, f[2], f[3]);
+        else if (command == "RENEW" && hasBook && f.size() == 3)
+            done = library.renewBook(bookID, f[2]);
+        else if (command == "RESERVE" && hasBook && f.size() == 3)
+            done = library.reserveBook(bookID, f[2]);
+        else if (command == "ADD_BOOK" && hasBook && f.size() >= 6)
+        {
+            Book book;
+            book.id = bookID;
+            book.title = f[2];
+            book.author = f[3];
+            book.category = f[4];
+            book.description = f.size() > 6 ? f[6] : "";
+            if (!toInt(f[5], book.totalCopies))
+                return "ERR bad copy count\n";
+            done = library.addBook(book);
+        }
+        else if (command == "UPDATE_BOOK" && hasBook && f.size() == 5)
+            done = library.updateBookDetails(bookID, f[2], f[3], f[4]);
+        else if (command == "REMOVE_BOOK" && hasBook)
+            done = library.removeBook(bookID);
+        else if (command == "REGISTER" && (f.size() == 5 || f.size() == 6))
+        {
+            Student student;
+            student.id = f[1];
+            student.name = f[2];
+            student.phoneNumber = f[3];
+            student.email = f[4];
+            if (f.size() == 6 && !toInt(f[5], student.patronClass))
+                return "ERR bad patron class\n";
+            done = library.registerStudent(student);
+        }
+        else if (command == "CHECKPOINT")
+        {
+            library.checkpointNow();
+            done = true;
+        }
+        else
+            return "ERR unknown command\n";
+
+        return done ? "OK\n" : "ERR rejected\n";
+    }
+
+    void handleLine(uint64_t id, Connection &conn, const vector<string> &fields)
+    {
+        Reply reply;
+        reply.sequence = conn.nextSequence++;
+
+        if (fields.empty())
+        {
+            reply.ready = true;
+            reply.text = "ERR empty request\n";
+        }
+        else if (fields[0] == "QUIT" || fields[0] == "SHUTDOWN")
+        {
+            reply.ready = true;
+            reply.text = "OK BYE\n";
+            conn.closing = true;
+            running = running && fields[0] != "SHUTDOWN";
+        }
+        else if (isSearch(fields[0]) || isWorkflow(fields[0]))
+        {
+            // Pipelined searches keep flowing; the reply slot waits in order for the worker.
+            // A workflow runs on a worker too, and parseLines holds the connection's later
+            // requests until it is done.
+            uint64_t sequence = reply.sequence;
+            bool workflow = isWorkflow(fields[0]);
+            if (workflow)
+                conn.writeRunning = true;
+            else
+                conn.searchesRunning++;
+            workers.submit([this, id, sequence, workflow, fields]
+                           {
+                string text = workflow ? runWorkflow(fields) : runSearch(fields);
+                {
+                    lock_guard<mutex> guard(completionLock);
+                    completions.push_back({id, sequence, workflow, text});
+                }
+                uint64_t one = 1;
+                ssize_t written = write(wakeFd, &one, sizeof(one));
+                (void)written; });
+        }
+        else
+        {
+            reply.ready = true;
+            reply.text = runCommand(fields);
+        }
+        conn.replies.push_back(reply);
+    }
+
+    void flush(uint64_t id, Connection &conn)
+    {
+        // Moves finished replies at the front of the queue to the socket, in order
+        while (!conn.replies.empty() && conn.replies.front().ready)
+        {
+            conn.output += conn.replies.front().text;
+            conn.replies.pop_front();
+            requestsServed++;
+        }
+        while (!conn.output.empty())
+        {
+            ssize_t sent = send(conn.fd, conn.output.data(), conn.output.size(), MSG_NOSIGNAL);
+            if (sent <= 0)
+                break;
+            conn.output.erase(0, sent);
+        }
+
+        if (conn.closing && conn.replies.empty() && conn.output.empty())
+        {
+            closeConnection(id);
+            return;
+        }
+
+        // Reading pauses while a full buffer of requests waits on earlier searches
+        bool reading = !conn.closing && !conn.inputEnded && conn.input.size() < (size_t)serverMaxRequestBytes;
+        epoll_event event{};
+        event.data.u64 = id;
+        event.events = (reading ? (uint32_t)EPOLLIN : 0u) | (conn.output.empty() ? 0u : (uint32_t)EPOLLOUT);
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &event);
+    }
+
+    void closeConnection(uint64_t id)
+    {
+        auto found = connections.find(id);
+        if (found == connections.end())
+            return;
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, found->second.fd, nullptr);
+        ::close(found->second.fd);
+        connections.erase(found); // replies still on workers are dropped when they arrive
+    }
+
+    void parseLines(uint64_t id, Connection &conn)
+    {
+        // Runs the complete lines read so far. Anything but a search waits until the
+        // connection's earlier searches are done, and everything waits for a workflow still
+        // on a worker, so each reply reflects exactly the requests before it on the
+        // connection; deliverCompletions resumes parsing.
+        size_t start = 0, newline;
+        bool waiting = false;
+        while (!conn.closing && (newline = conn.input.find('\n', start)) != string::npos)
+        {
+            string line = conn.input.substr(start, newline - start);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            vector<string> fields = split(line);
+            if (conn.writeRunning || (conn.searchesRunning > 0 && (fields.empty() || !isSearch(fields[0]))))
+            {
+                waiting = true;
+                break;
+            }
+            handleLine(id, conn, fields);
+            start = newline + 1;
+        }
+        conn.input.erase(0, start);
+        if (waiting || conn.closing)
+            return;
+
+        if (conn.input.size() >= (size_t)serverMaxRequestBytes)
+        {
+            // No line end within the limit: answer once and hang up rather than buffer without bound
+            Reply reply;
+            reply.sequence = conn.nextSequence++;
+            reply.ready = true;
+            reply.text = "ERR request too long\n";
+            conn.replies.push_back(reply);
+            conn.input.clear();
+            conn.closing = true;
+        }
+        conn.closing = conn.closing || conn.inputEnded; // the client may still be waiting for pipelined replies
+    }
+
+    void readFrom(uint64_t id)
+    {
+        Connection &conn = connections[id];
+        char buffer[16384];
+        while (conn.input.size() < (size_t)serverMaxRequestBytes)
+        {
+            ssize_t received = recv(conn.fd, buffer, sizeof(buffer), 0);
+            if (received > 0)
+            {
+                conn.input.append(buffer, received);
+                continue;
+            }
+            if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                closeConnection(id);
+                return;
             }
-        } while (adminChoice != 0);
+            conn.inputEnded = received == 0;
+            break;
+        }
+
+        parseLines(id, conn);
+        flush(id, conn);
     }
 
-    // Helper function for Student menu (not part of public interface)
-    void handleStudentMenu()
+    void acceptClients()
     {
-        string studentID;
-        cout << "Enter your Student ID: ";
-        getline(cin, studentID);
-        Student *student = findStudentById(studentID);
-        if (!student)
+        while (true)
         {
-            cout << "Student ID not found. Returning to main menu." << endl;
-            displayMainMenu();
-            return;
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+                return;
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // fails harmlessly on UNIX sockets
+
+            uint64_t id = nextConnectionId++;
+            connections[id].fd = fd;
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u64 = id;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
         }
+    }
 
-        int studentChoice;
-        do
-        {
-            cout << "\nStudent Menu (ID: " << studentID << "):" << endl;
-            cout << "1. Search Books by Title" << endl;
-            cout << "2. Filter Books by Category" << endl;
-            cout << "3. Borrow Book" << endl;
-            cout << "4. Return Book" << endl;
-            cout << "5. Renew Book" << endl;
-            cout << "6. Reserve Book" << endl;
-            cout << "7. View Fine" << endl;
-            cout << "8. Display All Books" << endl;
-            cout << "9. Display Borrowed Books" << endl;
-            cout << "0. Back to Main Menu" << endl;
-            cout << "Enter your choice: ";
-            cin >> studentChoice;
-            cin.ignore(); // Clear input buffer
+    void deliverCompletions()
+    {
+        uint64_t count;
+        ssize_t drained = read(wakeFd, &count, sizeof(count));
+        (void)drained;
 
-            switch (studentChoice)
-            {
-            case 1:
+        vector<Completion> done;
+        {
+            lock_guard<mutex> guard(completionLock);
+            done.swap(completions);
+        }
+        set<uint64_t> touched;
+        for (Completion &completion : done)
+        {
+            auto found = connections.find(completion.connection);
+            if (found == connections.end())
+                continue;
+            for (Reply &reply : found->second.replies)
             {
-                string titleKeyword;
-                cout << "Enter title keyword: ";
-                getline(cin, titleKeyword);
-                vector<Book *> results = searchBooksByTitle(titleKeyword);
-                if (results.empty())
-                {
-                    cout << "No books found." << endl;
-                }
-                else
+                if (reply.sequence == completion.sequence)
                 {
-                    cout << "Found books:" << endl;
-                    for (auto *b : results)
-                    {
-                        cout << "ID: " << b->id << ", Title: " << b->title << ", Author: " << b->author << endl;
-                    }
+                    reply.ready = true;
+                    reply.text = move(completion.text);
+                    break;
                 }
-                break;
             }
-            case 2:
-            {
-                string category;
-                cout << "Enter category: ";
-                getline(cin, category);
-                vector<Book *> results = filterBooksByCategory(category);
-                if (results.empty())
-                {
-                    cout << "No books found in this category." << endl;
-                }
-                else
-                {
-                    cout << "Books in category " << category << ":" << endl;
-                    for (auto *b : results)
-                    {
-                        cout << "ID: " << b->id << ", Title: " << b->title << ", Author: " << b->author << endl;
-                    }
-                }
+            if (completion.write)
+                found->second.writeRunning = false;
+            else
+                found->second.searchesRunning--;
+            touched.insert(completion.connection);
+        }
+        for (uint64_t id : touched)
+        {
+            auto found = connections.find(id);
+            if (found == connections.end())
+                continue;
+            parseLines(id, found->second); // requests held back behind the searches
+            flush(id, found->second);
+        }
+    }
+
+    bool setUp(int fd)
+    {
+        listenFd = fd;
+        if (listen(listenFd, 512) != 0)
+            return false;
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epollFd < 0 || wakeFd < 0)
+            return false;
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = 0;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+        event.data.u64 = 1;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+        return true;
+    }
+
+public:
+    LibraryServer(LibraryManagementSystem &library) : library(library) {}
+
+    ~LibraryServer()
+    {
+        // Workers must not hand back replies through wakeFd once it is closed
+        workers.stop();
+        while (!connections.empty())
+            closeConnection(connections.begin()->first);
+        for (int fd : {listenFd, epollFd, wakeFd})
+        {
+            if (fd >= 0)
+                ::close(fd);
+        }
+    }
+
+    bool listenTcp(int port)
+    {
+        // Loopback only: terminals connect from the same host
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd < 0 || bind(fd, (sockaddr *)&address, sizeof(address)) != 0)
+            return false;
+        return setUp(fd);
+    }
+
+    bool listenUnix(const string &path)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+            return false;
+        strcpy(address.sun_path, path.c_str());
+        unlink(path.c_str());
+        if (fd < 0 || bind(fd, (sockaddr *)&address, sizeof(address)) != 0)
+            return false;
+        return setUp(fd);
+    }
+
+    void run()
+    {
+        // Serves until a client sends SHUTDOWN
+        vector<epoll_event> events(256);
+        while (running)
+        {
+            int ready = epoll_wait(epollFd, events.data(), events.size(), -1);
+            if (ready < 0 && errno != EINTR)
                 break;
-            }
-            case 3:
+            for (int i = 0; i < ready; i++)
             {
-                int bookID;
-                cout << "Enter Book ID to borrow: ";
-                cin >> bookID;
-                if (borrowBook(bookID, studentID))
-                {
-                    cout << "Book borrowed successfully." << endl;
-                }
-                else
+                uint64_t id = events[i].data.u64;
+                if (id == 0)
+                    acceptClients();
+                else if (id == 1)
+                    deliverCompletions();
+                else if (connections.count(id))
                 {
-                    cout << "Failed to borrow book." << endl;
+                    if (events[i].events & EPOLLERR)
+                        closeConnection(id);
+                    else if (events[i].events & (EPOLLIN | EPOLLHUP))
+                        readFrom(id);
+                    else
+                        flush(id, connections[id]);
                 }
-                break;
             }
-            case 4:
+        }
+    }
+
+    long long getRequestsServed()
+    {
+        return requestsServed;
+    }
+};
+
+// Load generator for a running server: each connection pipelines batches of mixed lookups and
+// searches and waits for every reply of a batch before sending the next
+void runLoadBenchmark(const string &socketPath, int connectionCount, int requestsPerConnection)
+{
+    const int batch = 64;
+    // Request, and whether its reply is a book list
+    const vector<pair<string, bool>> mix = {{"BOOK|1", true},    {"PING", false},      {"SEARCH|DSA", true},
+                                            {"BOOK|2", true},    {"FINE|S001", false}, {"CATEGORY|Computer Science", true},
+                                            {"COMPLETE|ds", true}, {"BOOK|3", true}};
+    atomic<long long> answered{0};
+    atomic<bool> failed{false};
+
+    auto client = [&](int connection)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+        if (fd < 0 || connect(fd, (sockaddr *)&address, sizeof(address)) != 0)
+        {
+            failed = true;
+            if (fd >= 0)
+                ::close(fd);
+            return;
+        }
+        string input;
+        for (int sent = 0; sent < requestsPerConnection && !failed; sent += batch)
+        {
+            string output;
+            vector<bool> lists;
+            for (int i = 0; i < batch; i++)
             {
-                int bookID;
-                string returnDate;
-                cout << "Enter Book ID to return: ";
-                cin >> bookID;
-                cin.ignore();
-                cout << "Enter Return Date (YYYY-MM-DD): ";
-                getline(cin, returnDate);
-                if (returnBook(bookID, studentID, returnDate))
-                {
-                    cout << "Book returned successfully." << endl;
-                }
-                else
-                {
-                    cout << "Failed to return book." << endl;
-                }
-                break;
+                const auto &request = mix[(sent + i + connection) % mix.size()];
+                output += request.first + "\n";
+                lists.push_back(request.second);
             }
-            case 5:
+            for (size_t written = 0; written < output.size();)
             {
-                int bookID;
-                cout << "Enter Book ID to renew: ";
-                cin >> bookID;
-                if (renewBook(bookID, studentID))
-                {
-                    cout << "Book renewed successfully." << endl;
-                }
-                else
+                ssize_t n = ::write(fd, output.data() + written, output.size() - written);
+                if (n <= 0)
                 {
-                    cout << "Failed to renew book." << endl;
+                    failed = true;
+                    break;
                 }
-                break;
+                written += n;
             }
-            case 6:
+
+            // A reply is one line, or "OK <n>" and n more lines for a book list
+            size_t next = 0, position = 0;
+            int linesLeft = -1;
+            while (next < lists.size() && !failed)
             {
-                int bookID;
-                cout << "Enter Book ID to reserve: ";
-                cin >> bookID;
-                if (reserveBook(bookID, studentID))
+                size_t end = input.find('\n', position);
+                if (end == string::npos)
                 {
-                    cout << "Book reserved successfully." << endl;
+                    input.erase(0, position);
+                    position = 0;
+                    char buffer[65536];
+                    ssize_t n = ::read(fd, buffer, sizeof(buffer));
+                    if (n <= 0)
+                        failed = true;
+                    else
+                        input.append(buffer, n);
+                    continue;
                 }
+                if (linesLeft < 0)
+                    linesLeft = lists[next] && input.compare(position, 3, "OK ") == 0 ? atoi(input.c_str() + position + 3) : 0;
                 else
+                    linesLeft--;
+                position = end + 1;
+                if (linesLeft == 0)
                 {
-                    cout << "Failed to reserve book." << endl;
+                    next++;
+                    linesLeft = -1;
                 }
-                break;
-            }
-            case 7:
-            {
-                int fine = calculateTotalFine(studentID);
-                cout << "Total fine: $" << fine << endl;
-                break;
             }
-            case 8:
+            input.erase(0, position);
+            answered += next;
+        }
+        ::close(fd);
+    };
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> clients;
+    for (int c = 0; c < connectionCount; c++)
+        clients.emplace_back(client, c);
+    for (thread &t : clients)
+        t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if (failed)
+        cout << "Lost the connection to " << socketPath << "; the figures below are partial." << endl;
+    cout << answered << " requests on " << connectionCount << " connections in " << fixed << setprecision(2) << seconds
+         << " s: " << setprecision(0) << answered / seconds << " ops/s" << endl;
+}
+
+#endif
+
+int main(int argc, char *argv[])
+{
+    // Command line: [--record <trace>] [--replay <trace> [speed]] [--serve <port> | --serve-unix <path>]
+    //               [--compact] [--memory-bench <books>] [--autocomplete-bench <books>]
+    //               [--fuzzy-bench <books> [all]] [--policy-bench <patrons>] [--branches <name,name,...>]
+    //               [--self-check] [--load-bench <path> [connections] [requests]]
+    string recordFile, replayFile, serveMode, serveTarget, branchNames, loadTarget;
+    bool selfCheck = false, fuzzyDescriptions = false;
+    double replaySpeed = 0;
+    int benchmarkBooks = 0, autocompleteBooks = 0, fuzzyBooks = 0, policyPatrons = 0;
+    int loadConnections = 8, loadRequests = 40000;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc)
+            recordFile = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            replayFile = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                replaySpeed = atof(argv[++i]);
+        }
+        else if ((arg == "--serve" || arg == "--serve-unix") && i + 1 < argc)
+        {
+            serveMode = arg;
+            serveTarget = argv[++i];
+        }
+        else if (arg == "--compact" && !compactStrings)
+        {
+            // Compact text storage is chosen when building, so a book field can shrink to an ID
+            cout << "This build keeps plain strings; rebuild with -DLMS_COMPACT_TEXT for compact storage." << endl;
+            return 1;
+        }
+        else if (arg == "--memory-bench" && i + 1 < argc)
+            benchmarkBooks = atoi(argv[++i]);
+        else if (arg == "--autocomplete-bench" && i + 1 < argc)
+            autocompleteBooks = atoi(argv[++i]);
+        else if (arg == "--fuzzy-bench" && i + 1 < argc)
+        {
+            fuzzyBooks = atoi(argv[++i]);
+            if (i + 1 < argc && string(argv[i + 1]) == "all")
             {
-                displayAllBooks();
-                break;
-            }
-            case 9:
-                displayBorrowedBooks(studentID);
-                break;
-            case 0:
-                displayMainMenu();
-                break;
-            default:
-                cout << "Invalid choice. Please try again." << endl;
+                fuzzyDescriptions = true;
+                i++;
             }
-        } while (studentChoice != 0);
+        }
+        else if (arg == "--policy-bench" && i + 1 < argc)
+            policyPatrons = atoi(argv[++i]);
+        else if (arg == "--branches" && i + 1 < argc)
+            branchNames = argv[++i];
+        else if (arg == "--self-check")
+            selfCheck = true;
+        else if (arg == "--load-bench" && i + 1 < argc)
+        {
+            loadTarget = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                loadConnections = max(1, atoi(argv[++i]));
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                loadRequests = max(1, atoi(argv[++i]));
+        }
     }
 
-    vector<Book> getAllBooks()
+    if (selfCheck)
+        return runSelfCheck() == 0 ? 0 : 1;
+
+    if (benchmarkBooks > 0)
     {
-        return books;
+        runMemoryBenchmark(benchmarkBooks);
+        return 0;
+    }
+    if (autocompleteBooks > 0)
+    {
+        runAutocompleteBenchmark(autocompleteBooks);
+        return 0;
+    }
+    if (fuzzyBooks > 0)
+    {
+        runFuzzyBenchmark(fuzzyBooks, fuzzyDescriptions);
+        return 0;
+    }
+    if (policyPatrons > 0)
+    {
+        runPolicyBenchmark(policyPatrons);
+        return 0;
+    }
+    if (!loadTarget.empty())
+    {
+#ifdef __linux__
+        runLoadBenchmark(loadTarget, loadConnections, loadRequests);
+        return 0;
+#else
+        cout << "The load generator is only available on Linux." << endl;
+        return 1;
+#endif
     }
-    // Returns a list of all books in the library.
-    // Used for browsing, reporting, and UI display.
 
-    void displayAllBooks()
+    // ===============================
+    // Branch Network Mode: one library per branch, each with its own data file
+    // ===============================
+    if (!branchNames.empty())
     {
-        if (books.empty())
+        LibraryNetwork network;
+        stringstream names(branchNames);
+        string name;
+        while (getline(names, name, ','))
         {
-            cout << "No books in the library." << endl;
-            return;
+            if (!name.empty() && network.addBranch(name) < 0)
+            {
+                cout << "Could not read library_data_" << name << ".txt; fix or move it and start again." << endl;
+                return 1;
+            }
         }
-        cout << "All Books in the Library:" << endl;
-        cout << left << setw(10) << "ID" << setw(30) << "Title" << setw(20) << "Author"
-             << setw(15) << "Category" << setw(10) << "Available" << setw(10) << "Total" << endl;
-        cout << string(95, '-') << endl;
-        for (const auto &book : books)
+        network.displayNetworkMenu();
+        return 0;
+    }
+
+    // ===============================
+    // Replay Mode: the trace carries the library it was recorded against
+    // ===============================
+    if (!replayFile.empty())
+    {
+        // Checkpoints and circulation events go to files of their own, emptied first so
+        // runs do not pile up and the real library data is never overwritten
+        string replayData = "replay_data.txt";
+        remove(replayData.c_str());
+        remove(LibraryManagementSystem::eventFileFor(replayData).c_str());
+        LibraryManagementSystem lms(replayData);
+        ReplayReport report;
+        if (!WorkloadReplayer::replay(lms, replayFile, replaySpeed, report))
         {
-            cout << left << setw(10) << book.id << setw(30) << book.title << setw(20) << book.author
-                 << setw(15) << book.category << setw(10) << book.availableCopies << setw(10) << book.totalCopies << endl;
+            cout << "Failed to read trace " << replayFile << " (missing, damaged or recorded by another version)" << endl;
+            return 1;
         }
+        WorkloadReplayer::display(report);
+        return 0;
     }
-    // Displays all books with formatted details for better readability.
-};
 
-int main()
-{
-    LibraryManagementSystem lms;
+    string dataFile = "library_data.txt";
+    LibraryManagementSystem lms(dataFile);
 
     // ===============================
-    // Dummy Books
+    // Startup: restore the saved library, or seed sample data on first run
     // ===============================
-    Book b1;
-    b1.id = 1;
-    b1.title = "DSA";
-    b1.author = "Mark Allen Weiss";
-    b1.category = "Computer Science";
-    b1.description = "Core DSA concepts";
-    b1.totalCopies = 3;
-    b1.availableCopies = 3;
-
-    Book b2;
-    b2.id = 2;
-    b2.title = "Introduction to Algorithms";
-    b2.author = "Cormen";
-    b2.category = "Computer Science";
-    b2.description = "Algorithm design and analysis";
-    b2.totalCopies = 2;
-    b2.availableCopies = 2;
-
-    Book b3;
-    b3.id = 3;
-    b3.title = "Clean Code";
-    b3.author = "Robert C. Martin";
-    b3.category = "Software Engineering";
-    b3.description = "Best coding practices";
-    b3.totalCopies = 4;
-    b3.availableCopies = 4;
-
-    lms.addBook(b1);
-    lms.addBook(b2);
-    lms.addBook(b3);
+    bool loaded = lms.loadLibraryData();
+    if (!loaded && ifstream(dataFile).good())
+    {
+        // Seeding would let the next checkpoint overwrite data that is only unreadable
+        cout << "Could not read " << dataFile << "; fix or move it and start again." << endl;
+        return 1;
+    }
+    if (!loaded)
+    {
+        // ===============================
+        // Dummy Books
+        // ===============================
+        Book b1;
+        b1.id = 1;
+        b1.title = "DSA";
+        b1.author = "Mark Allen Weiss";
+        b1.category = "Computer Science";
+        b1.description = "Core DSA concepts";
+        b1.totalCopies = 3;
+        b1.availableCopies = 3;
+
+        Book b2;
+        b2.id = 2;
+        b2.title = "Introduction to Algorithms";
+        b2.author = "Cormen";
+        b2.category = "Computer Science";
+        b2.description = "Algorithm design and analysis";
+        b2.totalCopies = 2;
+        b2.availableCopies = 2;
+
+        Book b3;
+        b3.id = 3;
+        b3.title = "Clean Code";
+        b3.author = "Robert C. Martin";
+        b3.category = "Software Engineering";
+        b3.description = "Best coding practices";
+        b3.totalCopies = 4;
+        b3.availableCopies = 4;
+
+        lms.addBook(b1);
+        lms.addBook(b2);
+        lms.addBook(b3);
+
+        // ===============================
+        // Dummy Students
+        // ===============================
+        Student s1;
+        s1.id = "S001";
+        s1.name = "Alice";
+        s1.phoneNumber = "0911111111";
+        s1.email = "alice@example.com";
+
+        Student s2;
+        s2.id = "S002";
+        s2.name = "Bob";
+        s2.phoneNumber = "0922222222";
+        s2.email = "bob@example.com";
+
+        lms.registerStudent(s1);
+        lms.registerStudent(s2);
+        lms.checkpointNow(); // the next start loads this instead of seeding again
+    }
+    if (!recordFile.empty() && !lms.startRecording(recordFile))
+    {
+        cout << "Failed to open trace " << recordFile << endl;
+        return 1;
+    }
 
     // ===============================
-    // Dummy Students
+    // Server Mode
     // ===============================
-    Student s1;
-    s1.id = "S001";
-    s1.name = "Alice";
-    s1.phoneNumber = "0911111111";
-    s1.email = "alice@example.com";
-
-    Student s2;
-    s2.id = "S002";
-    s2.name = "Bob";
-    s2.phoneNumber = "0922222222";
-    s2.email = "bob@example.com";
-
-    lms.registerStudent(s1);
-    lms.registerStudent(s2);
+    if (!serveMode.empty())
+    {
+#ifdef __linux__
+        LibraryServer server(lms);
+        bool listening = serveMode == "--serve" ? server.listenTcp(atoi(serveTarget.c_str())) : server.listenUnix(serveTarget);
+        if (!listening)
+        {
+            cout << "Failed to listen on " << serveTarget << endl;
+            return 1;
+        }
+        cout << "Serving on " << serveTarget << " (send SHUTDOWN to stop)" << endl;
+        server.run();
+        cout << "Served " << server.getRequestsServed() << " requests." << endl;
+        TransactionStats stats = lms.getTransactionStats();
+        cout << "Transfers and exchanges: " << stats.committed << " committed, " << stats.refused << " refused, "
+             << stats.conflicts << " restaged after a conflict." << endl;
+        return 0;
+#else
+        cout << "Server mode is only available on Linux." << endl;
+        return 1;
+#endif
+    }
+
     // ===============================
     // Start Menu Loop
     // ===============================